@@ -41,9 +41,13 @@ typedef struct TreeMgmt{
 
 const int BT_NUM_PAGES = 100;
 const ReplacementStrategy BT_REPLACEMENT_STRATEGY = RS_LRU;
+BM_BufferPool *indexCache = NULL;       // shared cache passed to initIndexManager, if any
 const int MAX_STRING_KEY_LENGTH = 10;
 const int BT_RESERVED_PAGES = 1;       // 0th page is for tree information
 
+// number of int slots one RID occupies in a leaf's pointer area
+#define RID_INTS ((int)(sizeof(RID) / sizeof(int)))
+
 // reads the info node into the BT_BtreeInfoNode for easier access; page must be pinned
 // memory must be freed by the caller
 BT_BtreeInfoNode *readTreeInfoNode(BM_PageHandle *nodePage) {
@@ -61,7 +65,7 @@ BT_BtreeInfoNode *readTreeInfoNode(BM_PageHandle *nodePage) {
 
 // reads a node into the BT_BtreeNode for easier access; page must be pinned
 // memory must be freed by the caller
-BT_BtreeNode *readTreeNodePage(BM_PageHandle *nodePage) {
+BT_BtreeNode *readTreeNodePage(BM_BufferPool *bufferPool, BM_PageHandle *nodePage) {
     BT_BtreeNode *node = (BT_BtreeNode*)malloc(sizeof(BT_BtreeNode));
 
     node->selfIdx = (int*)(nodePage->data);
@@ -74,12 +78,26 @@ BT_BtreeNode *readTreeNodePage(BM_PageHandle *nodePage) {
 
     // the pointers to the children are filled bottom up from the end of the block
     // in case of non leaf nodes, childrenIdx[-n] will access the nth key's pointer
-    // in case of leaf nodes, childrenIdx[-2n-1] and childrenIdx[-2n] will access page and slot for the nth key respectively
-    node->childrenIdx = (int*)((char*)nodePage->data + PAGE_SIZE - sizeof(int));
+    // in case of leaf nodes, the nth key's RID occupies RID_INTS ints starting at childrenIdx[-RID_INTS*n - (RID_INTS-1)]
+    node->childrenIdx = (int*)((char*)nodePage->data + getPoolPageSize(bufferPool) - sizeof(int));
 
     return node;
 }
 
+// smallest page size that holds a node with n keys, or -1 if even the largest page is too small
+int nodePageSize(int keySize, int n) {
+    int header = 5*sizeof(int) + sizeof(bool);
+    int leafBytes = n*(keySize + sizeof(RID));
+    int innerBytes = n*keySize + (n+1)*sizeof(int);
+    int needed = header + (leafBytes > innerBytes ? leafBytes : innerBytes);
+
+    int pageSize = PAGE_SIZE;
+    while(pageSize < needed && pageSize < SM_MAX_PAGE_SIZE) {
+        pageSize *= 2;
+    }
+    return pageSize < needed ? -1 : pageSize;
+}
+
 // used to initialize the values in a newly created node
 void initializeNewNode(BT_BtreeNode *node, int selfIdx) {
     *(node->selfIdx) = selfIdx;         // self page index
@@ -167,17 +185,17 @@ int lowerBoundIdx(BT_BtreeInfoNode *infoNode, BT_BtreeNode *node, Value *key) {
 }
 
 // finds the index of a leaf node in which the given key belongs
-int findLeafNodeForKey(BTreeHandle *tree, Value *key) {
+PageNumber findLeafNodeForKey(BTreeHandle *tree, Value *key) {
     TreeMgmt *treeMgmt = (TreeMgmt *)(tree->mgmtData);
     BT_BtreeInfoNode *infoNode = treeMgmt->infoNode;
 
-    int nodeIdx = *(infoNode->rootNodeIdx);
+    PageNumber nodeIdx = *(infoNode->rootNodeIdx);
     BM_PageHandle *nodePage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
 
     pinPage(treeMgmt->bufferPool, nodePage, nodeIdx);
     markDirty(treeMgmt->bufferPool, nodePage);
 
-    BT_BtreeNode *node = readTreeNodePage(nodePage);
+    BT_BtreeNode *node = readTreeNodePage(treeMgmt->bufferPool, nodePage);
 
     // loop while we don't reach a leaf
     while( *(node->isLeaf) == FALSE ) {
@@ -190,7 +208,7 @@ int findLeafNodeForKey(BTreeHandle *tree, Value *key) {
 
         pinPage(treeMgmt->bufferPool, nodePage, nodeIdx);
         markDirty(treeMgmt->bufferPool, nodePage);
-        node = readTreeNodePage(nodePage);
+        node = readTreeNodePage(treeMgmt->bufferPool, nodePage);
     }
     unpinPage(treeMgmt->bufferPool, nodePage);
     free(nodePage);
@@ -229,9 +247,9 @@ void splitNode(BT_BtreeInfoNode *infoNode, BT_BtreeNode *leftSibling, BT_BtreeNo
     // copy rightSiblingSize keys from leftSibling to rightSibling starting from splitIdx
     memcpy( (rightSibling->keyValues), (leftSibling->keyValues + splitIdx*keySize), rightSiblingSize*keySize);
 
-    // if it's a leaf, multiply the pointer copy size by 2 because RID occupies twice the space
+    // if it's a leaf, multiply the pointer copy size by RID_INTS because of the RID
     if(isLeaf) {
-        memcpy( &(rightSibling->childrenIdx[-2*rightSiblingSize+1]), &(leftSibling->childrenIdx[-2*numKeys+1]), 2*rightSiblingSize*sizeof(int) );
+        memcpy( &(rightSibling->childrenIdx[-RID_INTS*rightSiblingSize+1]), &(leftSibling->childrenIdx[-RID_INTS*numKeys+1]), RID_INTS*rightSiblingSize*sizeof(int) );
     }
     else {
         memcpy( &(rightSibling->childrenIdx[-rightSiblingSize]), &(leftSibling->childrenIdx[-numKeys]), rightSiblingSize*sizeof(int) );
@@ -249,9 +267,9 @@ void shiftKeysAndPointers(BT_BtreeInfoNode *infoNode, BT_BtreeNode *node, int st
     // shift (numKeys-startIdx) keys to the right, starting from startIdx
     memmove( (node->keyValues + (startIdx+shiftCount) * keySize), (node->keyValues + startIdx * keySize), (numKeys - startIdx) * keySize);
 
-    // if it's a leaf, multiply the copy size by 2 because of RID
+    // if it's a leaf, multiply the copy size by RID_INTS because of RID
     if(isLeaf) {
-        memmove( (node->childrenIdx - 2*(numKeys+shiftCount) + 1), (node->childrenIdx - 2*numKeys + 1), 2*(numKeys - startIdx)*sizeof(int) );
+        memmove( (node->childrenIdx - RID_INTS*(numKeys+shiftCount) + 1), (node->childrenIdx - RID_INTS*numKeys + 1), RID_INTS*(numKeys - startIdx)*sizeof(int) );
     }
     else {
         memmove( (node->childrenIdx - numKeys - shiftCount), (node->childrenIdx - numKeys), (numKeys - startIdx)*sizeof(int) );
@@ -280,7 +298,7 @@ void insertKeyAndIndexIntoNode(BTreeHandle *tree, BT_BtreeNode *node, Value *key
         pinPage(treeMgmt->bufferPool, rightSiblingPage, rightSiblingIdx);
         markDirty(treeMgmt->bufferPool, rightSiblingPage);
 
-        BT_BtreeNode *rightSiblingNode = readTreeNodePage(rightSiblingPage);
+        BT_BtreeNode *rightSiblingNode = readTreeNodePage(treeMgmt->bufferPool, rightSiblingPage);
         initializeNewNode(rightSiblingNode, rightSiblingIdx);
 
         // find the position the new key would occupy after insertion
@@ -308,7 +326,7 @@ void insertKeyAndIndexIntoNode(BTreeHandle *tree, BT_BtreeNode *node, Value *key
             pinPage(treeMgmt->bufferPool, parentPage, parentIdx);
             markDirty(treeMgmt->bufferPool, parentPage);
 
-            parentNode = readTreeNodePage(parentPage);
+            parentNode = readTreeNodePage(treeMgmt->bufferPool, parentPage);
             initializeNewNode(parentNode, parentIdx);
 
             // update parent
@@ -333,7 +351,7 @@ void insertKeyAndIndexIntoNode(BTreeHandle *tree, BT_BtreeNode *node, Value *key
             pinPage(treeMgmt->bufferPool, parentPage, parentIdx);
             markDirty(treeMgmt->bufferPool, parentPage);
 
-            parentNode = readTreeNodePage(parentPage);
+            parentNode = readTreeNodePage(treeMgmt->bufferPool, parentPage);
 
             insertKeyAndIndexIntoNode(tree, parentNode, keyIntoParent, &rightSiblingIdx);
         }
@@ -365,7 +383,7 @@ void insertKeyAndIndexIntoNode(BTreeHandle *tree, BT_BtreeNode *node, Value *key
 
         if(isLeaf) {
             // copy RID info
-            memcpy(node->childrenIdx - 2*keyIdx - 1, value, 2*sizeof(int));
+            memcpy(node->childrenIdx - RID_INTS*keyIdx - (RID_INTS-1), value, sizeof(RID));
         }
         else {
             // copy child index
@@ -377,29 +395,27 @@ void insertKeyAndIndexIntoNode(BTreeHandle *tree, BT_BtreeNode *node, Value *key
     }
 }
 
+// mgmtData may be a buffer cache (initBufferCache) the indexes then share instead of each
+// getting a private pool
 RC initIndexManager (void *mgmtData) {
     initStorageManager();
+    indexCache = (BM_BufferPool *) mgmtData;
     return RC_OK;
 }
 
 RC shutdownIndexManager () {
+    indexCache = NULL;
     return RC_OK;
 }
 
+RC openIndexPool (BM_BufferPool *bufferPool, char *idxId) {
+    if (indexCache != NULL)
+        return openPoolInCache(bufferPool, indexCache, idxId, 0);
+    return initBufferPool(bufferPool, idxId, BT_NUM_PAGES, BT_REPLACEMENT_STRATEGY, NULL);
+}
+
 //create a new tree, with the name idxId, data type and the number in each node
 RC createBtree (char *idxId, DataType keyType, int n) {
-    RC rc;
-    rc = createPageFile(idxId);
-    if (rc != RC_OK)
-        return rc;
-
-    BM_BufferPool *bufferPool = (BM_BufferPool*)malloc(sizeof(BM_BufferPool));
-    initBufferPool(bufferPool, idxId, BT_NUM_PAGES, BT_REPLACEMENT_STRATEGY, NULL);  // initialize a new buffer pool
-
-    BM_PageHandle *infoPage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
-    pinPage(bufferPool, infoPage, 0);
-    markDirty(bufferPool, infoPage);
-
     int keySize;
     if (keyType == DT_INT)
         keySize = sizeof(int);
@@ -410,6 +426,23 @@ RC createBtree (char *idxId, DataType keyType, int n) {
     else if (keyType == DT_STRING)
         keySize = MAX_STRING_KEY_LENGTH * sizeof(char);
 
+    // the index file gets the smallest page size a node with n keys fits in
+    int pageSize = nodePageSize(keySize, n);
+    if (pageSize < 0)
+        return RC_IM_N_TO_LAGE;
+
+    RC rc;
+    rc = createPageFileWithSize(idxId, pageSize);
+    if (rc != RC_OK)
+        return rc;
+
+    BM_BufferPool *bufferPool = (BM_BufferPool*)malloc(sizeof(BM_BufferPool));
+    openIndexPool(bufferPool, idxId);  // initialize a new buffer pool
+
+    BM_PageHandle *infoPage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
+    pinPage(bufferPool, infoPage, 0);
+    markDirty(bufferPool, infoPage);
+
     BT_BtreeInfoNode *infoNode = readTreeInfoNode(infoPage);
     *(infoNode->rootNodeIdx) = BT_RESERVED_PAGES;       // root node index
     *(infoNode->keyType) = keyType;                     // type of the key
@@ -426,7 +459,7 @@ RC createBtree (char *idxId, DataType keyType, int n) {
     pinPage(bufferPool, treeRootNodePage, BT_RESERVED_PAGES);
     markDirty(bufferPool, treeRootNodePage);
 
-    BT_BtreeNode *treeRootNode = readTreeNodePage(treeRootNodePage);
+    BT_BtreeNode *treeRootNode = readTreeNodePage(bufferPool, treeRootNodePage);
 
     // initialize the root
     initializeNewNode(treeRootNode, BT_RESERVED_PAGES);
@@ -442,7 +475,7 @@ RC createBtree (char *idxId, DataType keyType, int n) {
 
 RC openBtree (BTreeHandle **tree, char *idxId) {
     BM_BufferPool *bufferPool = (BM_BufferPool*)malloc(sizeof(BM_BufferPool));
-    initBufferPool(bufferPool, idxId, BT_NUM_PAGES, BT_REPLACEMENT_STRATEGY, NULL);  // initialize a new buffer pool
+    openIndexPool(bufferPool, idxId);  // initialize a new buffer pool
 
     BM_PageHandle *infoPage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
     pinPage(bufferPool, infoPage, 0);
@@ -508,13 +541,13 @@ RC findKey (BTreeHandle *tree, Value *key, RID *result) {
     int keySize = *(infoNode->keySize);
 
     // find the leaf node in which the key belongs
-    int nodeIdx = findLeafNodeForKey(tree, key);
+    PageNumber nodeIdx = findLeafNodeForKey(tree, key);
 
     BM_PageHandle *nodePage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
     pinPage(treeMgmt->bufferPool, nodePage, nodeIdx);
     markDirty(treeMgmt->bufferPool, nodePage);
 
-    BT_BtreeNode *node = readTreeNodePage(nodePage);
+    BT_BtreeNode *node = readTreeNodePage(treeMgmt->bufferPool, nodePage);
 
     // get the first key value > given key value; if the given key exists, it must exist just before that key value
     int keyIdx = lowerBoundIdx(infoNode, node, key) - 1;
@@ -530,7 +563,7 @@ RC findKey (BTreeHandle *tree, Value *key, RID *result) {
 
     if(comparisionResult->v.boolV == TRUE) {
         rc = RC_OK;
-        memcpy(result, (node->childrenIdx - 2*keyIdx - 1), 2*sizeof(int));
+        memcpy(result, (node->childrenIdx - RID_INTS*keyIdx - (RID_INTS-1)), sizeof(RID));
     }
 
     free(comparisionResult);
@@ -546,13 +579,13 @@ RC insertKey (BTreeHandle *tree, Value *key, RID rid) {
     BT_BtreeInfoNode *infoNode = treeMgmt->infoNode;
 
     // find the leaf node in which the key belongs
-    int nodeIdx = findLeafNodeForKey(tree, key);
+    PageNumber nodeIdx = findLeafNodeForKey(tree, key);
 
     BM_PageHandle *nodePage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
     pinPage(treeMgmt->bufferPool, nodePage, nodeIdx);
     markDirty(treeMgmt->bufferPool, nodePage);
 
-    BT_BtreeNode *node = readTreeNodePage(nodePage);
+    BT_BtreeNode *node = readTreeNodePage(treeMgmt->bufferPool, nodePage);
     insertKeyAndIndexIntoNode(tree, node, key, &rid);
 
     // increment total keys in the tree
@@ -575,14 +608,14 @@ RC deleteKey (BTreeHandle *tree, Value *key) {
     int keySize = *(infoNode->keySize);
 
     // find the leaf node in which the key belongs
-    int nodeIdx = findLeafNodeForKey(tree, key);
+    PageNumber nodeIdx = findLeafNodeForKey(tree, key);
 
 
     BM_PageHandle *nodePage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
     pinPage(treeMgmt->bufferPool, nodePage, nodeIdx);
     markDirty(treeMgmt->bufferPool, nodePage);
 
-    BT_BtreeNode *node = readTreeNodePage(nodePage);
+    BT_BtreeNode *node = readTreeNodePage(treeMgmt->bufferPool, nodePage);
 
     // get the first key value > given key value; is the given key exists, it must exist just before that key value
     int keyIdx = lowerBoundIdx(infoNode, node, key) - 1;
@@ -616,13 +649,13 @@ RC openTreeScan (BTreeHandle *tree, BT_ScanHandle **handle) {
     TreeMgmt *treeMgmt = (TreeMgmt *)(tree->mgmtData);
     BT_BtreeInfoNode *infoNode = treeMgmt->infoNode;
 
-    int nodeIdx = *(infoNode->rootNodeIdx);
+    PageNumber nodeIdx = *(infoNode->rootNodeIdx);
     BM_PageHandle *nodePage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
 
     pinPage(treeMgmt->bufferPool, nodePage, nodeIdx);
     markDirty(treeMgmt->bufferPool, nodePage);
 
-    BT_BtreeNode *node = readTreeNodePage(nodePage);
+    BT_BtreeNode *node = readTreeNodePage(treeMgmt->bufferPool, nodePage);
 
     // loop while we don't reach a leaf
     while( *(node->isLeaf) == FALSE ) {
@@ -634,7 +667,7 @@ RC openTreeScan (BTreeHandle *tree, BT_ScanHandle **handle) {
 
         pinPage(treeMgmt->bufferPool, nodePage, nodeIdx);
         markDirty(treeMgmt->bufferPool, nodePage);
-        node = readTreeNodePage(nodePage);
+        node = readTreeNodePage(treeMgmt->bufferPool, nodePage);
     }
 
     unpinPage(treeMgmt->bufferPool, nodePage);
@@ -660,13 +693,13 @@ RC nextEntry (BT_ScanHandle *handle, RID *result) {
 
     RID *id = (handle->mgmtData);
 
-    int nodeIdx = id->page;
+    PageNumber nodeIdx = id->page;
     int keyIdx = id->slot;
 
     BM_PageHandle *nodePage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
     pinPage(treeMgmt->bufferPool, nodePage, nodeIdx);
 
-    BT_BtreeNode *node = readTreeNodePage(nodePage);
+    BT_BtreeNode *node = readTreeNodePage(treeMgmt->bufferPool, nodePage);
 
     // if at the last key of this node, try loading next sibling
     if(*(node->numKeys) == keyIdx) {
@@ -678,19 +711,26 @@ RC nextEntry (BT_ScanHandle *handle, RID *result) {
 
         // if no more right siblings
         if( id->page == -1) {
+            free(nodePage);
             return RC_IM_NO_MORE_ENTRIES;
         }
         // load the right sibling page
         else {
             pinPage(treeMgmt->bufferPool, nodePage, id->page);
-            node = readTreeNodePage(nodePage);
+            node = readTreeNodePage(treeMgmt->bufferPool, nodePage);
         }
     }
+    // entering a leaf: start reading the next one while this one's entries are returned
+    if(id->slot == 0 && *(node->rightSiblingIdx) != -1) {
+        prefetchPage(treeMgmt->bufferPool, *(node->rightSiblingIdx));
+    }
     do {
-        memcpy(result, (node->childrenIdx - 2*(id->slot) - 1), sizeof(RID));
+        memcpy(result, (node->childrenIdx - RID_INTS*(id->slot) - (RID_INTS-1)), sizeof(RID));
     } while(result->page == 0 || result->slot == 0);
 
     id->slot++;
+    unpinPage(treeMgmt->bufferPool, nodePage);
+    free(nodePage);
     free(node);
     return RC_OK;
 }
@@ -733,7 +773,7 @@ char *dfs(BTreeHandle *tree, BT_BtreeNode *curNode, int *idx) {
                 continue;
             // load child node
             pinPage(treeMgmt->bufferPool, curChildPage, curChildPageIdx);
-            curChildNode = readTreeNodePage(curChildPage);
+            curChildNode = readTreeNodePage(treeMgmt->bufferPool, curChildPage);
 
             APPEND(result, "%d,", *idx);
             char *curChildStr = dfs(tree, curChildNode, idx);
@@ -743,8 +783,8 @@ char *dfs(BTreeHandle *tree, BT_BtreeNode *curNode, int *idx) {
         }
         else if(i<numKeys) {
             RID *id = (RID*)malloc(sizeof(RID));
-            memcpy(id, (curNode->childrenIdx - 2*i - 1), 2*sizeof(int));
-            APPEND(result, "%d.%d,", id->page, id->slot);
+            memcpy(id, (curNode->childrenIdx - RID_INTS*i - (RID_INTS-1)), sizeof(RID));
+            APPEND(result, "%lld.%d,", (long long) id->page, id->slot);
             free(id);
         }
         if(i<numKeys) {
@@ -766,18 +806,19 @@ char *printTree (BTreeHandle *tree) {
     TreeMgmt *treeMgmt = (TreeMgmt *)(tree->mgmtData);
     BT_BtreeInfoNode *infoNode = treeMgmt->infoNode;
 
-    int rootNodeIdx = *(infoNode->rootNodeIdx);
+    PageNumber rootNodeIdx = *(infoNode->rootNodeIdx);
 
     BM_PageHandle *rootNodePage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
 
     pinPage(treeMgmt->bufferPool, rootNodePage, rootNodeIdx);
     markDirty(treeMgmt->bufferPool, rootNodePage);
 
-    BT_BtreeNode *rootNode = readTreeNodePage(rootNodePage);
+    BT_BtreeNode *rootNode = readTreeNodePage(treeMgmt->bufferPool, rootNodePage);
 
     int idx = 0;
     char *result = dfs(tree, rootNode, &idx);
 
+    unpinPage(treeMgmt->bufferPool, rootNodePage);
     free(rootNodePage);
     free(rootNode);
     return result;
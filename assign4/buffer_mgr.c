@@ -1,5 +1,10 @@
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <limits.h>
+#include <time.h>
+#include <pthread.h>
 #include "buffer_mgr.h"
 #include "dberror.h"
 #include "storage_mgr.h"
@@ -11,462 +16,4166 @@ typedef struct PageFrame {
     int fixCount;
     // counter to keep track of frequency of hits
 	int hitNum;
-	// array to keep track of recent accesses
-	// LRU_array[i] is the time of (i+1)th most recent access
+	// ring of the last K access times; LRU_array[histHead] is the most recent one
 	int *LRU_array;
+	int histHead;
+	// RS_LFU: the frequency bucket holding the frame and its neighbours in the bucket's recency list
+	int lfuBucket;
+	int lfuPrev, lfuNext;
+	// prefetch: the read is still in flight (the prefetch holds one fix until it is reaped), and
+	// the page has not been pinned since it was prefetched
+	bool ioPending;
+	bool prefetched;
+	// a miss is writing back the page it evicted from the frame and reading its own page in, with
+	// the pool latch released; pins of the page wait on ioDone until it is loaded
+	bool loading;
+	// content latch held by pinPageShared/pinPageExclusive callers until they unpin; like data it
+	// belongs to the frame's page, so both stay put while the page is pinned, even when
+	// resizeBufferPool moves the frame
+	pthread_rwlock_t *latch;
 } PageFrame;
 
-int K;
-int front, rear;
-int clock;
-int globalHitCount;
-int writeCnt, readCnt;
-bool *dirtyFlags;
-int *fixCounts;
-PageNumber *pageNums;
+// page buffers and content latches come in chunks: one aligned allocation for the frames a pool
+// starts with and one more for each grow. A chunk is freed once no frame uses any of its slots
+typedef struct BM_FrameChunk {
+	char *data;
+	pthread_rwlock_t *latches;
+	int count;
+	// filled in by chunkScan during a resize: the frame field (or spare) using each buffer, and
+	// the frame using each latch
+	SM_PageHandle **dataOwner;
+	PageFrame **latchOwner;
+	struct BM_FrameChunk *next;
+} BM_FrameChunk;
 
-void FIFO(BM_BufferPool *const bm, PageFrame *page)
-{
-	PageFrame *pf = (PageFrame *) bm->mgmtData;
-	int i;
-	// if the page already exists, increment its fixCount
-	for(i = 0; i < bm->numPages; i++) {
-		if(pf[i].pageNum == page->pageNum) {
-			pf[i].fixCount++;
-			return;
+// open-addressing (linear probing) map from page number to an index; the table is a power
+// of two at least twice the number of entries it has to hold, empty slots hold NO_PAGE
+typedef struct BM_PageMap {
+	PageNumber *keys;
+	int *vals;
+	int mask;
+} BM_PageMap;
+
+// a replacement list threaded through BM_PoolMgmt.nodePrev/nodeNext, head is the most recent
+typedef struct BM_List {
+	int head, tail;
+	int size;
+} BM_List;
+
+// replacement lists kept in BM_PoolMgmt.lists; which ones are used depends on the strategy
+#define BM_LIST_LRU 0	// RS_LRU: every frame, most recently used first
+#define BM_LIST_FREE 0	// RS_ARC, RS_2Q: frames that have not held a page yet
+#define BM_LIST_T1 1	// RS_ARC: pages referenced once recently
+#define BM_LIST_T2 2	// RS_ARC: pages referenced at least twice recently
+#define BM_LIST_B1 3	// RS_ARC: ghosts of pages evicted from T1
+#define BM_LIST_B2 4	// RS_ARC: ghosts of pages evicted from T2
+#define BM_LIST_A1IN 1	// RS_2Q: FIFO of pages referenced once
+#define BM_LIST_AM 2	// RS_2Q: LRU of pages referenced again after leaving A1in
+#define BM_LIST_A1OUT 3	// RS_2Q: ghosts of pages evicted from A1in
+#define BM_NUM_LISTS 5
+
+// RS_CLOCK_PRO flags of a ring node (BM_PoolMgmt.cpFlags); a cold page has no CP_HOT
+#define CP_HOT 1	// resident hot page
+#define CP_TEST 2	// cold page in its test period; every ghost on the ring is one
+
+// RS_LFU: all frames with the same use count, most recently used at head; buckets form a list
+// ordered by count, next has the higher one
+typedef struct LFU_Bucket {
+	int freq;
+	int head, tail;
+	int prev, next;
+} LFU_Bucket;
+
+// pages are keyed by (file id, page number) packed into one PageNumber, so pages of many files
+// can share a cache; a pool opened on its own file uses file 0, whose keys are the page numbers.
+// Either way a pool's page numbers have to fit in the low BM_FILE_BITS, larger ones are rejected
+#define BM_FILE_BITS 40
+#define BM_MAX_PAGE ((((PageNumber)1) << BM_FILE_BITS) - 1)
+#define BM_PAGE_IN_RANGE(pageNum) ((pageNum) >= 0 && (pageNum) <= BM_MAX_PAGE)
+#define BM_KEY(fileId, pageNum) (((PageNumber)(fileId) << BM_FILE_BITS) | (pageNum))
+#define BM_FILE_OF(key) ((int)((key) >> BM_FILE_BITS))
+#define BM_PAGE_OF(key) ((key) & BM_MAX_PAGE)
+
+// the page files a pool (or shared cache) reads from, by file id; ids are never reused, so the
+// clean pages a closed file leaves behind are simply never hit again and age out
+typedef struct BM_FileTable {
+	SM_FileHandle **handles; // NULL once the file's pool is shut down
+	int *quota;              // most frames the file's pages may hold, 0 = no limit
+	int *frames;             // frames holding the file's pages right now
+	int *reads, *writes;     // page I/Os done for the file
+	int *busy;               // transfers running on the file's handle; closing it waits for idle
+	int numFiles, capacity;
+	int pageSize;            // frame size; a file's pages may not be larger
+	SM_IOMode ioMode;
+	bool shared;             // a cache: its frames are only used through pools opened in it
+	BM_LatencyHistogram readLatency, writeLatency; // of all files in the table
+	// guards the table, the counters and file growth; page transfers run outside it, on a handle
+	// fileAcquire hands out
+	pthread_mutex_t lock;
+	pthread_cond_t idle;
+} BM_FileTable;
+
+// bookkeeping stored in bm->mgmtData
+typedef struct BM_PoolMgmt {
+	PageFrame *frames;
+	// the chunks holding the frames' buffers and latches, newest first; an async miss swaps the
+	// victim's buffer with spare, the page it was read into (a buffer of the first chunk). One
+	// miss at a time uses the spare (spareBusy); spareDone tells it its read has been reaped
+	BM_FrameChunk *chunks;
+	SM_PageHandle spare;
+	bool spareBusy, spareDone;
+	// slab for the frames' LRU_array histories
+	int *history;
+	// page files stay open for the lifetime of the pool; all shards of a pool share its table
+	BM_FileTable *files;
+	// a pool opened in a shared cache (openPoolInCache) has no frames of its own: its calls go to
+	// cache, with its page numbers keyed by fileId
+	struct BM_BufferPool *cache;
+	int fileId;
+	// a sharded pool holds no frames itself: page p lives in shards[shardIndex(p)], each an
+	// independent pool with its own frames, page map, replacement state and latch
+	int numShards;
+	struct BM_BufferPool *shards;
+	// asynchronous I/O engine, NULL until the pool needs one; it is only driven with the latch
+	// held. Misses read through it only when the pool was configured with useAsyncIO (and so has
+	// a spare page) and a dirty victim is written back meanwhile
+	SM_AsyncIO *aio;
+	// prefetch: one request per frame, the number in flight and the most allowed in flight
+	SM_AsyncRequest *prefetchReqs;
+	int prefetchInFlight;
+	int prefetchLimit;
+	// page number -> frame index
+	BM_PageMap frameMap;
+	// shared caches only: this shard's frames of each file, most recently used first, so a file
+	// over its quota finds its least recently used page without scanning the frames
+	int *fileNext, *filePrev; // by frame
+	int *fileHead, *fileTail; // by file id, fileLists of them
+	int fileLists;
+	// number of frames with a non-zero fixCount
+	int pinnedFrames;
+	// page I/O done with the latch released: frames loading or fixed for a write (ioInFlight, a
+	// resize waits for none), writes among them (writesInFlight, a flush waits for none), and the
+	// pages misses evicted and are still writing back, to the frame that held them (wbMap); a pin
+	// of such a page waits instead of reading a stale copy. ioDone is broadcast as each finishes
+	int ioInFlight, writesInFlight;
+	BM_PageMap wbMap;
+	pthread_cond_t ioDone;
+	// set around a miss's replacement: the strategy leaves the dirty victim's write-back to the
+	// miss and records its page in victimKey (NO_PAGE if the victim was clean)
+	bool deferWriteBack;
+	PageNumber victimKey;
+	// replacement state: history length for LRU-K, FIFO queue ends, CLOCK hand
+	// and the logical access time used to order LRU/LFU references
+	int K;
+	int front, rear;
+	int clock;
+	int globalHitCount;
+	// I/O counters reported by getNumReadIO/getNumWriteIO
+	int readCnt, writeCnt;
+	// counters reported by getPoolStats
+	long hits, misses, cleanEvictions, dirtyEvictions, pinWaits, failedPins;
+	long victimSearches, victimSearchSteps;
+	// replacement lists (see BM_LIST_*); nodes 0..numPages-1 are frames, the nodes after them are
+	// ghosts that remember the page numbers RS_ARC and RS_2Q evicted, nodeList is a node's list or -1
+	BM_List lists[BM_NUM_LISTS];
+	int *nodePrev, *nodeNext, *nodeList;
+	PageNumber *ghostPages;
+	BM_PageMap ghostMap;
+	int ghostFree;
+	// RS_ARC: adaptive target size of T1; RS_2Q: capacities of A1in and A1out
+	int arcTarget;
+	int kin, kout;
+	// RS_CLOCK: saturation limit of the frames' usage counters (hitNum)
+	int clockMaxCount;
+	// RS_CLOCK_PRO: one ring of resident frames and ghosts through nodePrev/nodeNext with three
+	// hands, node flags, the number of hot pages and ghosts, and the adaptive cold target
+	int *cpFlags;
+	int handHot, handCold, handTest;
+	int cpHot, cpGhosts, coldTarget;
+	// RS_LRU_K: indexed min-heap of the unpinned frames, heapPos[i] is frame i's slot or -1
+	int *heap;
+	int *heapPos;
+	int heapSize;
+	// RS_LFU: bucket storage, the lowest-count bucket, unused buckets (chained by next),
+	// and how many pinPage calls pass between halving all use counts (0 = never)
+	LFU_Bucket *buckets;
+	int bucketFirst;
+	int bucketFree;
+	int lfuAgingInterval;
+	// pool latch: every public call holds it, but none does page I/O under it (only a shrink
+	// writes back the pages it evicts with it held)
+	pthread_mutex_t lock;
+	// background writer (see BM_PoolConfig), bgStop asks it to exit and bgWake cuts its wait short
+	pthread_t bgThread;
+	pthread_cond_t bgWake;
+	bool bgRunning, bgStop;
+	int bgDirtyHigh, bgDirtyLow, bgMaxWrites, bgIntervalMs;
+	// a pin that finds every frame pinned waits up to pinWaitMs (-1 = forever) for frameFreed,
+	// which is broadcast whenever a frame's fix count drops to zero
+	int pinWaitMs;
+	pthread_cond_t frameFreed;
+	// BM_PoolConfig.syncOnFlush, in a pool's top-level bookkeeping
+	bool syncOnFlush;
+	// warm-up (see BM_PoolConfig.warmupManifest), in a pool's top-level bookkeeping: the manifest,
+	// the pages the loader thread reads from it, and warmStop (under warmLock) to stop the loader
+	char *manifest;
+	PageNumber *warmPages;
+	int warmCount;
+	pthread_t warmThread;
+	pthread_mutex_t warmLock;
+	bool warmRunning, warmStop;
+} BM_PoolMgmt;
+
+// a scan's private ring, one sub-ring of size slots per shard: slot k of sub-ring s remembers
+// the frame it last filled in shard s (frames[s * size + k]) and the page it put there
+struct BM_ScanRing {
+	int numRings;
+	int size;
+	int *next;
+	int *frames;
+	PageNumber *pages;
+};
+
+// a dirty frame the background writer may write back, with its evictionRanks rank
+typedef struct BM_DirtyPage {
+	PageNumber pageNum;
+	int frame;
+	long rank;
+} BM_DirtyPage;
+
+// maximum number of requests a pool keeps in flight
+#define BM_ASYNC_QUEUE_DEPTH 64
+
+
+static void pageMapInit(BM_PageMap *map, int entries) {
+	int size = 2;
+	while(size < 2 * entries) {
+		size *= 2;
+	}
+	map->keys = (PageNumber *) malloc(size * sizeof(PageNumber));
+	map->vals = (int *) malloc(size * sizeof(int));
+	for(int i = 0; i < size; i++) {
+		map->keys[i] = NO_PAGE;
+	}
+	map->mask = size - 1;
+}
+
+static void pageMapFree(BM_PageMap *map) {
+	free(map->keys);
+	free(map->vals);
+}
+
+static int pageMapSlot(BM_PageMap *map, PageNumber key) {
+	return (int)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32) & map->mask;
+}
+
+// value stored for key, or -1
+static int pageMapGet(BM_PageMap *map, PageNumber key) {
+	int i = pageMapSlot(map, key);
+	while(map->keys[i] != NO_PAGE) {
+		if(map->keys[i] == key) {
+			return map->vals[i];
 		}
+		i = (i + 1) & map->mask;
 	}
+	return -1;
+}
 
-	for(i = 0; i < bm->numPages; i++) {
-		if(pf[i].pageNum == NO_PAGE) {
-			rear++;
-			pf[rear].data = page->data;
-			pf[rear].pageNum = page->pageNum;
-			pf[rear].isDirty = page->isDirty;
-			pf[rear].fixCount = page->fixCount;
+static void pageMapPut(BM_PageMap *map, PageNumber key, int val) {
+	int i = pageMapSlot(map, key);
+	while(map->keys[i] != NO_PAGE && map->keys[i] != key) {
+		i = (i + 1) & map->mask;
+	}
+	map->keys[i] = key;
+	map->vals[i] = val;
+}
+
+static void pageMapRemove(BM_PageMap *map, PageNumber key) {
+	int mask = map->mask;
+	int i = pageMapSlot(map, key);
+	while(map->keys[i] != key) {
+		if(map->keys[i] == NO_PAGE) {
 			return;
 		}
+		i = (i + 1) & mask;
+	}
+
+	// pull later entries of the probe run back into the hole so lookups never stop early
+	int j = i;
+	while(1) {
+		j = (j + 1) & mask;
+		if(map->keys[j] == NO_PAGE) {
+			break;
+		}
+		int home = pageMapSlot(map, map->keys[j]);
+		if(((j - home) & mask) >= ((j - i) & mask)) {
+			map->keys[i] = map->keys[j];
+			map->vals[i] = map->vals[j];
+			i = j;
+		}
+	}
+	map->keys[i] = NO_PAGE;
+}
+
+// frame index holding pageNum, or -1 if the page is not in the pool
+static int lookupFrame(BM_PoolMgmt *mgmt, PageNumber pageNum) {
+	return pageMapGet(&mgmt->frameMap, pageNum);
+}
+
+static void fileTableInit(BM_FileTable *files, int pageSize, SM_IOMode ioMode, bool shared) {
+	files->handles = NULL;
+	files->quota = files->frames = files->reads = files->writes = files->busy = NULL;
+	files->numFiles = files->capacity = 0;
+	files->pageSize = pageSize;
+	files->ioMode = ioMode;
+	files->shared = shared;
+	memset(&files->readLatency, 0, sizeof(BM_LatencyHistogram));
+	memset(&files->writeLatency, 0, sizeof(BM_LatencyHistogram));
+	pthread_mutex_init(&files->lock, NULL);
+	pthread_cond_init(&files->idle, NULL);
+}
+
+// adds an open file (or NULL, to reserve an id) and returns its id
+static int fileTableAdd(BM_FileTable *files, SM_FileHandle *fHandle, int quota) {
+	pthread_mutex_lock(&files->lock);
+	if(files->numFiles == files->capacity) {
+		files->capacity = (files->capacity > 0) ? 2 * files->capacity : 4;
+		files->handles = (SM_FileHandle **) realloc(files->handles, files->capacity * sizeof(SM_FileHandle *));
+		files->quota = (int *) realloc(files->quota, files->capacity * sizeof(int));
+		files->frames = (int *) realloc(files->frames, files->capacity * sizeof(int));
+		files->reads = (int *) realloc(files->reads, files->capacity * sizeof(int));
+		files->writes = (int *) realloc(files->writes, files->capacity * sizeof(int));
+		files->busy = (int *) realloc(files->busy, files->capacity * sizeof(int));
+	}
+	int f = files->numFiles++;
+	files->handles[f] = fHandle;
+	files->quota[f] = (quota > 0) ? quota : 0;
+	files->frames[f] = files->reads[f] = files->writes[f] = files->busy[f] = 0;
+	pthread_mutex_unlock(&files->lock);
+	return f;
+}
+
+static void fileTableClose(BM_FileTable *files, int f) {
+	pthread_mutex_lock(&files->lock);
+	while(files->busy[f] > 0) {
+		pthread_cond_wait(&files->idle, &files->lock);
+	}
+	if(files->handles[f] != NULL) {
+		closePageFile(files->handles[f]);
+		free(files->handles[f]);
+		files->handles[f] = NULL;
+	}
+	pthread_mutex_unlock(&files->lock);
+}
+
+// closes every file still open and frees the table
+static void fileTableFree(BM_FileTable *files) {
+	for(int f = 0; f < files->numFiles; f++) {
+		fileTableClose(files, f);
+	}
+	free(files->handles);
+	free(files->quota);
+	free(files->frames);
+	free(files->reads);
+	free(files->writes);
+	free(files->busy);
+	pthread_mutex_destroy(&files->lock);
+	pthread_cond_destroy(&files->idle);
+	free(files);
+}
+
+static void clockNow(struct timespec *t) {
+	clock_gettime(CLOCK_MONOTONIC, t);
+}
+
+// adds the time since start to a latency histogram
+static void recordLatency(BM_LatencyHistogram *hist, struct timespec *start) {
+	struct timespec end;
+	clockNow(&end);
+	long micros = (end.tv_sec - start->tv_sec) * 1000000L + (end.tv_nsec - start->tv_nsec) / 1000L;
+	int b = 0;
+	while(b < BM_LATENCY_BUCKETS - 1 && micros > (1L << b)) {
+		b++;
+	}
+	hist->buckets[b]++;
+	hist->count++;
+	hist->sumMicros += micros;
+}
+
+// file f's handle, or NULL if the file is closed; it stays open until fileRelease, so the
+// transfer in between needs no lock
+static SM_FileHandle *fileAcquire(BM_FileTable *files, int f) {
+	pthread_mutex_lock(&files->lock);
+	SM_FileHandle *fHandle = files->handles[f];
+	if(fHandle != NULL) {
+		files->busy[f]++;
+	}
+	pthread_mutex_unlock(&files->lock);
+	return fHandle;
+}
+
+// ends a transfer of pages pages begun at start (none for a sync, start NULL) and counts it
+static void fileRelease(BM_FileTable *files, int f, bool isWrite, int pages, struct timespec *start) {
+	pthread_mutex_lock(&files->lock);
+	if(start != NULL) {
+		recordLatency(isWrite ? &files->writeLatency : &files->readLatency, start);
+		if(isWrite) {
+			files->writes[f] += pages;
+		}
+		else {
+			files->reads[f] += pages;
+		}
+	}
+	if(--files->busy[f] == 0) {
+		pthread_cond_broadcast(&files->idle);
+	}
+	pthread_mutex_unlock(&files->lock);
+}
+
+static RC poolRead(BM_PoolMgmt *mgmt, PageNumber key, SM_PageHandle data) {
+	int f = BM_FILE_OF(key);
+	SM_FileHandle *fHandle = fileAcquire(mgmt->files, f);
+	if(fHandle == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	struct timespec start;
+	clockNow(&start);
+	RC rc = readBlock(BM_PAGE_OF(key), fHandle, data);
+	fileRelease(mgmt->files, f, FALSE, 1, &start);
+	return rc;
+}
+
+// reads pages of file f with one call that merges runs of adjacent pages (see readBlockList)
+static RC poolReadList(BM_PoolMgmt *mgmt, int f, PageNumber *pageNums, int count, SM_PageHandle *data) {
+	SM_FileHandle *fHandle = fileAcquire(mgmt->files, f);
+	if(fHandle == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	struct timespec start;
+	clockNow(&start);
+	RC rc = readBlockList(pageNums, count, fHandle, data);
+	fileRelease(mgmt->files, f, FALSE, count, &start);
+	return rc;
+}
+
+static RC poolWrite(BM_PoolMgmt *mgmt, PageNumber key, SM_PageHandle data) {
+	int f = BM_FILE_OF(key);
+	SM_FileHandle *fHandle = fileAcquire(mgmt->files, f);
+	if(fHandle == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	struct timespec start;
+	clockNow(&start);
+	RC rc = writeBlock(BM_PAGE_OF(key), fHandle, data);
+	fileRelease(mgmt->files, f, TRUE, 1, &start);
+	return rc;
+}
+
+// writes pages of file f with one call that merges runs of adjacent pages (see writeBlockList)
+static RC poolWriteList(BM_PoolMgmt *mgmt, int f, PageNumber *pageNums, int count, SM_PageHandle *data) {
+	SM_FileHandle *fHandle = fileAcquire(mgmt->files, f);
+	if(fHandle == NULL) {
+		return RC_FILE_HANDLE_NOT_INIT;
+	}
+	struct timespec start;
+	clockNow(&start);
+	RC rc = writeBlockList(pageNums, count, fHandle, data);
+	fileRelease(mgmt->files, f, TRUE, count, &start);
+	return rc;
+}
+
+// makes the writes to file f, or to every open file if f is -1, durable
+static RC poolSync(BM_PoolMgmt *mgmt, int f) {
+	BM_FileTable *files = mgmt->files;
+	pthread_mutex_lock(&files->lock);
+	int numFiles = files->numFiles;
+	pthread_mutex_unlock(&files->lock);
+	RC rc = RC_OK;
+	for(int g = 0; g < numFiles; g++) {
+		SM_FileHandle *fHandle = (f == -1 || g == f) ? fileAcquire(files, g) : NULL;
+		if(fHandle != NULL) {
+			RC syncRc = syncPageFile(fHandle);
+			rc = (rc == RC_OK) ? syncRc : rc;
+			fileRelease(files, g, TRUE, 0, NULL);
+		}
+	}
+	return rc;
+}
+
+// grows the page's file so that the page exists
+static RC poolEnsurePage(BM_PoolMgmt *mgmt, PageNumber key) {
+	BM_FileTable *files = mgmt->files;
+	int f = BM_FILE_OF(key);
+	pthread_mutex_lock(&files->lock);
+	RC rc = RC_FILE_HANDLE_NOT_INIT;
+	if(files->handles[f] != NULL) {
+		rc = ensureCapacity(BM_PAGE_OF(key) + 1, files->handles[f]);
+	}
+	pthread_mutex_unlock(&files->lock);
+	return rc;
+}
+
+static bool poolHasPage(BM_PoolMgmt *mgmt, PageNumber key) {
+	BM_FileTable *files = mgmt->files;
+	int f = BM_FILE_OF(key);
+	pthread_mutex_lock(&files->lock);
+	bool exists = files->handles[f] != NULL && BM_PAGE_OF(key) < files->handles[f]->totalNumPages;
+	pthread_mutex_unlock(&files->lock);
+	return exists;
+}
+
+// fills in an async read of the page and counts it
+static void poolAsyncRead(BM_PoolMgmt *mgmt, PageNumber key, SM_PageHandle data, SM_AsyncRequest *req) {
+	BM_FileTable *files = mgmt->files;
+	int f = BM_FILE_OF(key);
+	pthread_mutex_lock(&files->lock);
+	req->fHandle = files->handles[f];
+	files->reads[f]++;
+	pthread_mutex_unlock(&files->lock);
+	req->pageNum = BM_PAGE_OF(key);
+	req->memPage = data;
+	req->isWrite = FALSE;
+}
+
+static void fileListUnlink(BM_PoolMgmt *mgmt, int i, int f) {
+	int prev = mgmt->filePrev[i], next = mgmt->fileNext[i];
+	if(prev != -1) {
+		mgmt->fileNext[prev] = next;
+	}
+	else {
+		mgmt->fileHead[f] = next;
+	}
+	if(next != -1) {
+		mgmt->filePrev[next] = prev;
+	}
+	else {
+		mgmt->fileTail[f] = prev;
+	}
+}
+
+// makes frame i the most recently used of file f's frames; the lists grow with the file table
+static void fileListPushHead(BM_PoolMgmt *mgmt, int i, int f) {
+	if(f >= mgmt->fileLists) {
+		int n = 2 * f + 2;
+		mgmt->fileHead = (int *) realloc(mgmt->fileHead, n * sizeof(int));
+		mgmt->fileTail = (int *) realloc(mgmt->fileTail, n * sizeof(int));
+		for(int k = mgmt->fileLists; k < n; k++) {
+			mgmt->fileHead[k] = mgmt->fileTail[k] = -1;
+		}
+		mgmt->fileLists = n;
+	}
+	int head = mgmt->fileHead[f];
+	mgmt->filePrev[i] = -1;
+	mgmt->fileNext[i] = head;
+	if(head != -1) {
+		mgmt->filePrev[head] = i;
+	}
+	else {
+		mgmt->fileTail[f] = i;
+	}
+	mgmt->fileHead[f] = i;
+}
+
+// a hit on frame i in a shared cache
+static void fileListTouch(BM_PoolMgmt *mgmt, int i) {
+	PageNumber key = mgmt->frames[i].pageNum;
+	if(mgmt->files->shared && key >= 0) {
+		fileListUnlink(mgmt, i, BM_FILE_OF(key));
+		fileListPushHead(mgmt, i, BM_FILE_OF(key));
+	}
+}
+
+// keeps the per-file frame counts (and a shared cache's per-file lists) right when frame i's
+// page changes
+static void countFileFrames(BM_PoolMgmt *mgmt, int i, PageNumber oldKey, PageNumber newKey) {
+	BM_FileTable *files = mgmt->files;
+	pthread_mutex_lock(&files->lock);
+	// NO_PAGE and the placeholders of a shrinking pool (see evictFrames) belong to no file
+	if(oldKey >= 0) {
+		files->frames[BM_FILE_OF(oldKey)]--;
+	}
+	if(newKey >= 0) {
+		files->frames[BM_FILE_OF(newKey)]++;
+	}
+	pthread_mutex_unlock(&files->lock);
+
+	if(files->shared) {
+		if(oldKey >= 0) {
+			fileListUnlink(mgmt, i, BM_FILE_OF(oldKey));
+		}
+		if(newKey >= 0) {
+			fileListPushHead(mgmt, i, BM_FILE_OF(newKey));
+		}
+	}
+}
+
+static int shardIndex(BM_BufferPool *const bm, PageNumber pageNum) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	if(mgmt->numShards == 1) {
+		return 0;
+	}
+	return (int)((((uint64_t)pageNum * 0x9E3779B97F4A7C15ULL) >> 32) % mgmt->numShards);
+}
+
+// shard s of a pool; an unsharded pool is its own only shard
+static BM_BufferPool *shardAt(BM_BufferPool *const bm, int s) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	return (mgmt->numShards == 1) ? bm : &mgmt->shards[s];
+}
+
+static BM_BufferPool *shardFor(BM_BufferPool *const bm, PageNumber pageNum) {
+	return shardAt(bm, shardIndex(bm, pageNum));
+}
+
+// the pool whose frames bm's calls work on, the cache for a pool opened in one, and the file
+// whose pages bm sees there (-1: all of them)
+static BM_BufferPool *framesOf(BM_BufferPool *const bm, int *fileId) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	*fileId = mgmt->fileId;
+	return (mgmt->cache != NULL) ? mgmt->cache : bm;
+}
+
+// locks every shard of pool, in the order resizeBufferPool takes them, and returns the number of
+// frames they hold then; the statistics calls and initScanRing read the pool's size under them
+static int lockShards(BM_BufferPool *const pool) {
+	BM_PoolMgmt *top = (BM_PoolMgmt *) pool->mgmtData;
+	int numPages = 0;
+	for(int s = 0; s < top->numShards; s++) {
+		BM_BufferPool *shard = shardAt(pool, s);
+		pthread_mutex_lock(&((BM_PoolMgmt *) shard->mgmtData)->lock);
+		numPages += shard->numPages;
+	}
+	return numPages;
+}
+
+static void unlockShards(BM_BufferPool *const pool) {
+	BM_PoolMgmt *top = (BM_PoolMgmt *) pool->mgmtData;
+	for(int s = top->numShards - 1; s >= 0; s--) {
+		pthread_mutex_unlock(&((BM_PoolMgmt *) shardAt(pool, s)->mgmtData)->lock);
+	}
+}
+
+static bool frameOfFile(PageFrame *frame, int fileId) {
+	return fileId == -1 || (frame->pageNum != NO_PAGE && BM_FILE_OF(frame->pageNum) == fileId);
+}
+
+// starts a fresh access history whose only entry is the current access
+static void resetHistory(BM_PoolMgmt *mgmt, PageFrame *frame) {
+	memset(frame->LRU_array, 0, mgmt->K * sizeof(int));
+	frame->histHead = 0;
+	frame->LRU_array[0] = mgmt->globalHitCount;
+}
+
+static void recordAccess(BM_PoolMgmt *mgmt, PageFrame *frame) {
+	frame->histHead = (frame->histHead + mgmt->K - 1) % mgmt->K;
+	frame->LRU_array[frame->histHead] = mgmt->globalHitCount;
+}
+
+static int lastAccess(PageFrame *frame) {
+	return frame->LRU_array[frame->histHead];
+}
+
+// time of the Kth most recent access, 0 if the page has been accessed fewer than K times
+static int kthAccess(BM_PoolMgmt *mgmt, PageFrame *frame) {
+	return frame->LRU_array[(frame->histHead + mgmt->K - 1) % mgmt->K];
+}
+
+static void listUnlink(BM_PoolMgmt *mgmt, int node) {
+	BM_List *list = &mgmt->lists[mgmt->nodeList[node]];
+	int prev = mgmt->nodePrev[node], next = mgmt->nodeNext[node];
+	if(prev != -1) {
+		mgmt->nodeNext[prev] = next;
+	}
+	else {
+		list->head = next;
+	}
+	if(next != -1) {
+		mgmt->nodePrev[next] = prev;
+	}
+	else {
+		list->tail = prev;
+	}
+	list->size--;
+	mgmt->nodeList[node] = -1;
+}
+
+static void listPushHead(BM_PoolMgmt *mgmt, int l, int node) {
+	BM_List *list = &mgmt->lists[l];
+	mgmt->nodePrev[node] = -1;
+	mgmt->nodeNext[node] = list->head;
+	if(list->head != -1) {
+		mgmt->nodePrev[list->head] = node;
+	}
+	else {
+		list->tail = node;
+	}
+	list->head = node;
+	list->size++;
+	mgmt->nodeList[node] = l;
+}
+
+static void listPushTail(BM_PoolMgmt *mgmt, int l, int node) {
+	BM_List *list = &mgmt->lists[l];
+	mgmt->nodeNext[node] = -1;
+	mgmt->nodePrev[node] = list->tail;
+	if(list->tail != -1) {
+		mgmt->nodeNext[list->tail] = node;
+	}
+	else {
+		list->head = node;
+	}
+	list->tail = node;
+	list->size++;
+	mgmt->nodeList[node] = l;
+}
+
+static void listMoveHead(BM_PoolMgmt *mgmt, int l, int node) {
+	listUnlink(mgmt, node);
+	listPushHead(mgmt, l, node);
+}
+
+// the unpinned frame closest to the tail of list l, or -1
+static int listVictim(BM_PoolMgmt *mgmt, int l) {
+	for(int i = mgmt->lists[l].tail; i != -1; i = mgmt->nodePrev[i]) {
+		mgmt->victimSearchSteps++;
+		if(mgmt->frames[i].fixCount == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// takes a free ghost node for pageNum; the caller makes sure one is free
+static int ghostAlloc(BM_PoolMgmt *mgmt, PageNumber pageNum) {
+	int g = mgmt->ghostFree;
+	mgmt->ghostFree = mgmt->nodeNext[g];
+	mgmt->ghostPages[g] = pageNum;
+	pageMapPut(&mgmt->ghostMap, pageNum, g);
+	return g;
+}
+
+static void ghostRelease(BM_PoolMgmt *mgmt, int g) {
+	pageMapRemove(&mgmt->ghostMap, mgmt->ghostPages[g]);
+	mgmt->nodeNext[g] = mgmt->ghostFree;
+	mgmt->ghostFree = g;
+}
+
+static void ghostDrop(BM_PoolMgmt *mgmt, int g) {
+	listUnlink(mgmt, g);
+	ghostRelease(mgmt, g);
+}
+
+// remembers an evicted page at the head of ghost list l
+static void ghostAdd(BM_PoolMgmt *mgmt, int l, PageNumber pageNum) {
+	if(mgmt->ghostFree == -1) {
+		ghostDrop(mgmt, mgmt->lists[l].tail);
+	}
+	listPushHead(mgmt, l, ghostAlloc(mgmt, pageNum));
+}
+
+// RS_CLOCK_PRO ring: inserts node just before at (or as the whole ring if it is empty)
+static void ringInsertBefore(BM_PoolMgmt *mgmt, int at, int node) {
+	if(at == -1) {
+		mgmt->nodePrev[node] = mgmt->nodeNext[node] = node;
+		mgmt->handHot = mgmt->handCold = mgmt->handTest = node;
+		return;
+	}
+	int prev = mgmt->nodePrev[at];
+	mgmt->nodePrev[node] = prev;
+	mgmt->nodeNext[node] = at;
+	mgmt->nodeNext[prev] = node;
+	mgmt->nodePrev[at] = node;
+}
+
+// takes node off the ring, moving any hand that points at it to the next node
+static void ringRemove(BM_PoolMgmt *mgmt, int node) {
+	int prev = mgmt->nodePrev[node], next = mgmt->nodeNext[node];
+	if(next == node) {
+		mgmt->handHot = mgmt->handCold = mgmt->handTest = -1;
+		return;
+	}
+	if(mgmt->handHot == node) {
+		mgmt->handHot = next;
+	}
+	if(mgmt->handCold == node) {
+		mgmt->handCold = next;
+	}
+	if(mgmt->handTest == node) {
+		mgmt->handTest = next;
+	}
+	mgmt->nodeNext[prev] = next;
+	mgmt->nodePrev[next] = prev;
+}
+
+// LRU-K order: empty frames first, then the oldest Kth most recent access, ties to the lower frame index
+static bool heapBefore(BM_PoolMgmt *mgmt, int a, int b) {
+	PageFrame *pf = mgmt->frames;
+	int keyA = (pf[a].pageNum == NO_PAGE) ? -1 : kthAccess(mgmt, &pf[a]);
+	int keyB = (pf[b].pageNum == NO_PAGE) ? -1 : kthAccess(mgmt, &pf[b]);
+	return keyA < keyB || (keyA == keyB && a < b);
+}
+
+static void heapSet(BM_PoolMgmt *mgmt, int pos, int frame) {
+	mgmt->heap[pos] = frame;
+	mgmt->heapPos[frame] = pos;
+}
+
+static void heapSiftUp(BM_PoolMgmt *mgmt, int pos) {
+	int frame = mgmt->heap[pos];
+	while(pos > 0 && heapBefore(mgmt, frame, mgmt->heap[(pos - 1) / 2])) {
+		heapSet(mgmt, pos, mgmt->heap[(pos - 1) / 2]);
+		pos = (pos - 1) / 2;
+	}
+	heapSet(mgmt, pos, frame);
+}
+
+static void heapSiftDown(BM_PoolMgmt *mgmt, int pos) {
+	int frame = mgmt->heap[pos];
+	while(2 * pos + 1 < mgmt->heapSize) {
+		int child = 2 * pos + 1;
+		if(child + 1 < mgmt->heapSize && heapBefore(mgmt, mgmt->heap[child + 1], mgmt->heap[child])) {
+			child++;
+		}
+		if(!heapBefore(mgmt, mgmt->heap[child], frame)) {
+			break;
+		}
+		heapSet(mgmt, pos, mgmt->heap[child]);
+		pos = child;
+	}
+	heapSet(mgmt, pos, frame);
+}
+
+// a frame is in the heap exactly while it is unpinned; its key only changes while it is pinned
+static void heapInsert(BM_PoolMgmt *mgmt, int frame) {
+	heapSet(mgmt, mgmt->heapSize++, frame);
+	heapSiftUp(mgmt, mgmt->heapSize - 1);
+}
+
+static void heapRemove(BM_PoolMgmt *mgmt, int frame) {
+	int pos = mgmt->heapPos[frame];
+	if(pos == -1) {
+		return;
+	}
+	mgmt->heapPos[frame] = -1;
+	int last = mgmt->heap[--mgmt->heapSize];
+	if(pos < mgmt->heapSize) {
+		heapSet(mgmt, pos, last);
+		heapSiftUp(mgmt, pos);
+		heapSiftDown(mgmt, mgmt->heapPos[last]);
+	}
+}
+
+// adds a chunk of count page buffers (aligned, so they can be handed straight to an O_DIRECT
+// descriptor) and count content latches to the front of the pool's list
+static BM_FrameChunk *chunkAlloc(BM_PoolMgmt *mgmt, int count) {
+	BM_FrameChunk *chunk = (BM_FrameChunk *) malloc(sizeof(BM_FrameChunk));
+	if(posix_memalign((void **)&chunk->data, SM_IO_ALIGNMENT, (size_t)count * mgmt->files->pageSize) != 0) {
+		free(chunk);
+		return NULL;
+	}
+	chunk->latches = (pthread_rwlock_t *) malloc(count * sizeof(pthread_rwlock_t));
+	for(int k = 0; k < count; k++) {
+		pthread_rwlock_init(&chunk->latches[k], NULL);
+	}
+	chunk->count = count;
+	chunk->dataOwner = NULL;
+	chunk->latchOwner = NULL;
+	chunk->next = mgmt->chunks;
+	mgmt->chunks = chunk;
+	return chunk;
+}
+
+static void chunkFree(BM_FrameChunk *chunk) {
+	for(int k = 0; k < chunk->count; k++) {
+		pthread_rwlock_destroy(&chunk->latches[k]);
+	}
+	free(chunk->latches);
+	free(chunk->data);
+	free(chunk->dataOwner);
+	free(chunk->latchOwner);
+	free(chunk);
+}
+
+static void chunkFreeAll(BM_PoolMgmt *mgmt) {
+	while(mgmt->chunks != NULL) {
+		BM_FrameChunk *next = mgmt->chunks->next;
+		chunkFree(mgmt->chunks);
+		mgmt->chunks = next;
+	}
+}
+
+// records that the buffer *data is used through data (a frame's field or spare) and, unless
+// frame is NULL, that frame uses its latch; a pinned frame's slots cannot move
+static void chunkClaim(BM_PoolMgmt *mgmt, SM_PageHandle *data, PageFrame *frame) {
+	size_t pageSize = mgmt->files->pageSize;
+	for(BM_FrameChunk *chunk = mgmt->chunks; chunk != NULL; chunk = chunk->next) {
+		uintptr_t off = (uintptr_t)*data - (uintptr_t)chunk->data;
+		if(off < chunk->count * pageSize) {
+			chunk->dataOwner[off / pageSize] = data;
+		}
+		if(frame != NULL) {
+			off = (uintptr_t)frame->latch - (uintptr_t)chunk->latches;
+			if(off < chunk->count * sizeof(pthread_rwlock_t)) {
+				chunk->latchOwner[off / sizeof(pthread_rwlock_t)] = frame;
+			}
+		}
+	}
+}
+
+// fills in the owners of every chunk's slots from the first count frames and spare; placeholder
+// frames (below NO_PAGE) are about to be dropped and give theirs up
+static void chunkScan(BM_PoolMgmt *mgmt, PageFrame *frames, int count) {
+	for(BM_FrameChunk *chunk = mgmt->chunks; chunk != NULL; chunk = chunk->next) {
+		chunk->dataOwner = (SM_PageHandle **) calloc(chunk->count, sizeof(SM_PageHandle *));
+		chunk->latchOwner = (PageFrame **) calloc(chunk->count, sizeof(PageFrame *));
+	}
+	for(int i = 0; i < count; i++) {
+		if(frames[i].pageNum >= NO_PAGE) {
+			chunkClaim(mgmt, &frames[i].data, &frames[i]);
+		}
+	}
+	if(mgmt->spare != NULL) {
+		chunkClaim(mgmt, &mgmt->spare, NULL);
+	}
+}
+
+// a buffer no frame uses, outside chunk skip, handed to owner
+static SM_PageHandle chunkTakeData(BM_PoolMgmt *mgmt, BM_FrameChunk *skip, SM_PageHandle *owner) {
+	for(BM_FrameChunk *chunk = mgmt->chunks; chunk != NULL; chunk = chunk->next) {
+		for(int k = 0; chunk != skip && k < chunk->count; k++) {
+			if(chunk->dataOwner[k] == NULL) {
+				chunk->dataOwner[k] = owner;
+				return chunk->data + (size_t)k * mgmt->files->pageSize;
+			}
+		}
+	}
+	return NULL;
+}
+
+// a latch no frame uses, outside chunk skip, handed to owner
+static pthread_rwlock_t *chunkTakeLatch(BM_PoolMgmt *mgmt, BM_FrameChunk *skip, PageFrame *owner) {
+	for(BM_FrameChunk *chunk = mgmt->chunks; chunk != NULL; chunk = chunk->next) {
+		for(int k = 0; chunk != skip && k < chunk->count; k++) {
+			if(chunk->latchOwner[k] == NULL) {
+				chunk->latchOwner[k] = owner;
+				return &chunk->latches[k];
+			}
+		}
+	}
+	return NULL;
+}
+
+// frees every chunk whose used slots fit into the free slots of the others: unpinned pages are
+// copied out and unpinned frames switch latches (no one holds the latch of an unpinned page).
+// Newest chunks go first, so a shrink after a grow gives the grown chunk back
+static void chunkCompact(BM_PoolMgmt *mgmt) {
+	size_t pageSize = mgmt->files->pageSize;
+	int freeData = 0, freeLatches = 0;
+	for(BM_FrameChunk *chunk = mgmt->chunks; chunk != NULL; chunk = chunk->next) {
+		for(int k = 0; k < chunk->count; k++) {
+			freeData += (chunk->dataOwner[k] == NULL);
+			freeLatches += (chunk->latchOwner[k] == NULL);
+		}
+	}
+
+	BM_FrameChunk **link = &mgmt->chunks;
+	while(*link != NULL) {
+		BM_FrameChunk *chunk = *link;
+		int usedData = 0, usedLatches = 0;
+		bool pinned = FALSE;
+		for(int k = 0; k < chunk->count; k++) {
+			SM_PageHandle *owner = chunk->dataOwner[k];
+			if(owner != NULL) {
+				usedData++;
+				pinned |= (owner != &mgmt->spare && ((PageFrame *)((char *)owner - offsetof(PageFrame, data)))->fixCount > 0);
+			}
+			if(chunk->latchOwner[k] != NULL) {
+				usedLatches++;
+				pinned |= (chunk->latchOwner[k]->fixCount > 0);
+			}
+		}
+		// the slots freed by moving out are not free for the move itself
+		int spareData = freeData - (chunk->count - usedData);
+		int spareLatches = freeLatches - (chunk->count - usedLatches);
+		if(pinned || usedData > spareData || usedLatches > spareLatches) {
+			link = &chunk->next;
+			continue;
+		}
+
+		for(int k = 0; k < chunk->count; k++) {
+			SM_PageHandle *owner = chunk->dataOwner[k];
+			if(owner != NULL) {
+				SM_PageHandle data = chunkTakeData(mgmt, chunk, owner);
+				memcpy(data, *owner, pageSize);
+				*owner = data;
+			}
+			PageFrame *frame = chunk->latchOwner[k];
+			if(frame != NULL) {
+				frame->latch = chunkTakeLatch(mgmt, chunk, frame);
+			}
+		}
+		freeData -= chunk->count;
+		freeLatches -= chunk->count;
+		*link = chunk->next;
+		chunkFree(chunk);
+	}
+}
+
+// drops the owner tables chunkScan filled in
+static void chunkScanDone(BM_PoolMgmt *mgmt) {
+	for(BM_FrameChunk *chunk = mgmt->chunks; chunk != NULL; chunk = chunk->next) {
+		free(chunk->dataOwner);
+		free(chunk->latchOwner);
+		chunk->dataOwner = NULL;
+		chunk->latchOwner = NULL;
+	}
+}
+
+// gives a new, empty frame a page buffer and content latch from a chunk; history is the frame's
+// slice of the LRU history slab
+static void frameInit(PageFrame *frame, SM_PageHandle data, pthread_rwlock_t *latch, int *history) {
+	frame->data = data;
+	frame->latch = latch;
+	frame->pageNum = NO_PAGE;
+	frame->isDirty = FALSE;
+	frame->fixCount = 0;
+	frame->hitNum = 0;
+	frame->LRU_array = history;
+	frame->histHead = 0;
+	frame->ioPending = FALSE;
+	frame->prefetched = FALSE;
+	frame->loading = FALSE;
+}
+
+// assigns page to frame i, replacing whatever page the frame held before;
+// the frame keeps its own buffer, pinPage fills it once the strategy has picked the frame
+static void placePage(BM_PoolMgmt *mgmt, int i, PageFrame *page) {
+	PageFrame *pf = mgmt->frames;
+	if(pf[i].pageNum != NO_PAGE) {
+		pageMapRemove(&mgmt->frameMap, pf[i].pageNum);
+	}
+	// the strategies write a dirty victim back before placing, its flag is still set here
+	if(pf[i].pageNum >= 0) {
+		if(pf[i].isDirty) {
+			mgmt->dirtyEvictions++;
+		}
+		else {
+			mgmt->cleanEvictions++;
+		}
+	}
+	countFileFrames(mgmt, i, pf[i].pageNum, page->pageNum);
+	pf[i].pageNum = page->pageNum;
+	pf[i].isDirty = page->isDirty;
+	pf[i].fixCount = page->fixCount;
+	pf[i].prefetched = FALSE;
+	resetHistory(mgmt, &pf[i]);
+	pageMapPut(&mgmt->frameMap, pf[i].pageNum, i);
+	if(pf[i].fixCount > 0) {
+		mgmt->pinnedFrames++;
+	}
+}
+
+// a strategy evicts frame i's dirty page: a miss or prefetch (deferWriteBack) writes it back
+// itself once the latch is released, a shrink has it written here
+static void writeBackVictim(BM_BufferPool *const bm, int i) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	if(mgmt->deferWriteBack) {
+		mgmt->victimKey = pf[i].pageNum;
+	}
+	else {
+		poolWrite(mgmt, pf[i].pageNum, pf[i].data);
+	}
+	mgmt->writeCnt++;
+}
+
+void FIFO(BM_BufferPool *const bm, PageFrame *page)
+{
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	int i;
+	// if the page already exists, increment its fixCount
+	i = lookupFrame(mgmt, page->pageNum);
+	if(i != -1) {
+		if(pf[i].fixCount++ == 0) {
+			mgmt->pinnedFrames++;
+		}
+		return;
+	}
+
+	// frames fill in order, but a frame whose read failed is emptied again (see unmapFrame)
+	for(i = 0; i < bm->numPages; i++) {
+		mgmt->victimSearchSteps++;
+		if(pf[i].pageNum == NO_PAGE) {
+			mgmt->rear = i;
+			placePage(mgmt, i, page);
+			return;
+		}
+	}
+
+	for(i=0; i < bm->numPages; i++) {
+		mgmt->victimSearchSteps++;
+		if(pf[mgmt->front].fixCount == 0) {
+			if(pf[mgmt->front].isDirty == TRUE) {
+				writeBackVictim(bm, mgmt->front);
+			}
+			placePage(mgmt, mgmt->front, page);
+			mgmt->front++;
+			mgmt->front = (mgmt->front % bm->numPages == 0) ? 0 : mgmt->front;
+			break;
+		}
+		else {
+			mgmt->front++;
+			mgmt->front = (mgmt->front % bm->numPages == 0) ? 0 : mgmt->front;
+		}
+	}
+}
+
+// GCLOCK: each frame's hitNum is a usage counter that a hit raises up to clockMaxCount and
+// the passing hand lowers; the hand takes the first unpinned frame whose counter is 0
+void CLOCK(BM_BufferPool *const bm, PageFrame *page)
+{
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	while(1)
+	{
+		mgmt->clock %= bm->numPages;
+		mgmt->victimSearchSteps++;
+
+		if(pf[mgmt->clock].hitNum == 0 && pf[mgmt->clock].fixCount == 0) {
+			if(pf[mgmt->clock].isDirty == TRUE) {
+				writeBackVictim(bm, mgmt->clock);
+			}
+
+			// loading the page counts as its first use
+			placePage(mgmt, mgmt->clock, page);
+			pf[mgmt->clock].hitNum = 1;
+			mgmt->clock++;
+			break;
+		}
+		else {
+			if(pf[mgmt->clock].hitNum > 0) {
+				pf[mgmt->clock].hitNum--;
+			}
+			mgmt->clock++;
+		}
+	}
+}
+
+// the cold target shrinks whenever a test period ends without the page being used again;
+// a ghost whose test period ends is forgotten
+static void cpEndTest(BM_BufferPool *const bm, int node) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	mgmt->cpFlags[node] &= ~CP_TEST;
+	if(mgmt->coldTarget > 1) {
+		mgmt->coldTarget--;
+	}
+	if(node >= bm->numPages) {
+		ringRemove(mgmt, node);
+		ghostRelease(mgmt, node);
+		mgmt->cpGhosts--;
+	}
+}
+
+// HAND_hot: turns the first hot page it finds unreferenced into a cold one, clearing the
+// reference bits of the others and ending the test periods of the cold pages it passes
+static void cpRunHandHot(BM_BufferPool *const bm) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	while(mgmt->cpHot > 0) {
+		int n = mgmt->handHot;
+		mgmt->handHot = mgmt->nodeNext[n];
+		mgmt->victimSearchSteps++;
+		if(mgmt->cpFlags[n] & CP_HOT) {
+			if(pf[n].hitNum > 0) {
+				pf[n].hitNum = 0;
+			}
+			else {
+				mgmt->cpFlags[n] = 0;
+				mgmt->cpHot--;
+				return;
+			}
+		}
+		else if(mgmt->cpFlags[n] & CP_TEST) {
+			cpEndTest(bm, n);
+		}
+	}
+}
+
+// HAND_test: ends test periods until it has forgotten one ghost
+static void cpRunHandTest(BM_BufferPool *const bm) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	while(mgmt->cpGhosts > 0) {
+		int n = mgmt->handTest;
+		mgmt->handTest = mgmt->nodeNext[n];
+		if(mgmt->cpFlags[n] & CP_TEST) {
+			cpEndTest(bm, n);
+			if(n >= bm->numPages) {
+				return;
+			}
+		}
+	}
+}
+
+// HAND_cold: frees the first unpinned cold page that was not referenced since the hand last
+// passed it; a referenced page in its test period becomes hot, any other referenced page
+// starts a test period. An evicted page still in its test period stays on the ring as a ghost.
+static int cpRunHandCold(BM_BufferPool *const bm) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+
+	// every step clears a reference bit or demotes a hot page, so a few turns always end on a
+	// victim; the bound only guards against pins held by the caller
+	for(int steps = 4 * (bm->numPages + mgmt->cpGhosts); steps > 0; steps--) {
+		int n = mgmt->handCold;
+		mgmt->handCold = mgmt->nodeNext[n];
+		mgmt->victimSearchSteps++;
+		if(n >= bm->numPages || (mgmt->cpFlags[n] & CP_HOT) || pf[n].fixCount > 0) {
+			continue;
+		}
+		if(pf[n].hitNum > 0) {
+			pf[n].hitNum = 0;
+			if(mgmt->cpFlags[n] & CP_TEST) {
+				mgmt->cpFlags[n] = CP_HOT;
+				mgmt->cpHot++;
+				if(mgmt->cpHot > bm->numPages - mgmt->coldTarget) {
+					cpRunHandHot(bm);
+				}
+			}
+			else {
+				mgmt->cpFlags[n] |= CP_TEST;
+				ringRemove(mgmt, n);
+				ringInsertBefore(mgmt, mgmt->handHot, n);
+			}
+			continue;
+		}
+
+		ringRemove(mgmt, n);
+		if(mgmt->cpFlags[n] & CP_TEST) {
+			if(mgmt->ghostFree == -1) {
+				cpRunHandTest(bm);
+			}
+			int g = ghostAlloc(mgmt, pf[n].pageNum);
+			mgmt->cpFlags[g] = CP_TEST;
+			mgmt->cpGhosts++;
+			ringInsertBefore(mgmt, mgmt->handCold, g);
+		}
+		mgmt->cpFlags[n] = 0;
+		return n;
+	}
+
+	// no cold page could be taken: fall back to any unpinned frame
+	for(int i = 0; i < bm->numPages; i++) {
+		mgmt->victimSearchSteps++;
+		if(pf[i].fixCount == 0) {
+			if(mgmt->cpFlags[i] & CP_HOT) {
+				mgmt->cpHot--;
+			}
+			mgmt->cpFlags[i] = 0;
+			ringRemove(mgmt, i);
+			return i;
+		}
+	}
+	return -1;
+}
+
+// CLOCK-Pro (Jiang, Chen and Zhang): hot and cold resident pages plus ghosts of recently evicted
+// cold pages share one clock. A cold page used again within its test period becomes hot, and
+// the share of frames kept for cold pages adapts to how often test periods catch reuse
+void CLOCK_PRO(BM_BufferPool *const bm, PageFrame *page) {
+
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	BM_List *lists = mgmt->lists;
+
+	// a miss on a ghost: the page was reused within its test period, give cold pages more room
+	int g = pageMapGet(&mgmt->ghostMap, page->pageNum);
+	if(g != -1) {
+		ringRemove(mgmt, g);
+		ghostRelease(mgmt, g);
+		mgmt->cpGhosts--;
+		if(mgmt->coldTarget < bm->numPages) {
+			mgmt->coldTarget++;
+		}
+	}
+
+	int i;
+	if(lists[BM_LIST_FREE].size > 0) {
+		i = lists[BM_LIST_FREE].tail;
+		listUnlink(mgmt, i);
+		mgmt->victimSearchSteps++;
+	}
+	else {
+		i = cpRunHandCold(bm);
+	}
+	if(i == -1) {
+		return;
+	}
+
+	// if the found page is dirty, write it back
+	if(pf[i].isDirty == TRUE) {
+		writeBackVictim(bm, i);
+	}
+	placePage(mgmt, i, page);
+	pf[i].hitNum = 0;
+
+	// until the hot share is used up (an empty pool), new pages are hot
+	if(g != -1 || mgmt->cpHot < bm->numPages - mgmt->coldTarget) {
+		mgmt->cpFlags[i] = CP_HOT;
+		mgmt->cpHot++;
+	}
+	else {
+		mgmt->cpFlags[i] = CP_TEST;
+	}
+	ringInsertBefore(mgmt, mgmt->handHot, i);
+	if(mgmt->cpHot > bm->numPages - mgmt->coldTarget) {
+		cpRunHandHot(bm);
+	}
+}
+
+// LRU: every frame sits in a list ordered by last access; the victim is the unpinned frame
+// closest to the least recently used end, and untouched (empty) frames stay at that end
+void LRU(BM_BufferPool *const bm, PageFrame *page) {
+
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+
+	int i = listVictim(mgmt, BM_LIST_LRU);
+	if(i != -1) {
+		// if the found page is dirty, write it back
+		if(pf[i].isDirty == TRUE) {
+			writeBackVictim(bm, i);
+		}
+		placePage(mgmt, i, page);
+		listMoveHead(mgmt, BM_LIST_LRU, i);
+	}
+}
+
+// ARC's REPLACE: evicts from T1 while T1 is above its target size, otherwise from T2, and
+// remembers the page in B1 or B2; pinned frames are skipped, falling back to the other list
+static int arcReplace(BM_PoolMgmt *mgmt, bool inB2) {
+	int t1 = mgmt->lists[BM_LIST_T1].size;
+	bool fromT1 = t1 >= 1 && (t1 > mgmt->arcTarget || (inB2 && t1 == mgmt->arcTarget));
+	int i = listVictim(mgmt, fromT1 ? BM_LIST_T1 : BM_LIST_T2);
+	if(i == -1) {
+		fromT1 = !fromT1;
+		i = listVictim(mgmt, fromT1 ? BM_LIST_T1 : BM_LIST_T2);
+	}
+	if(i != -1) {
+		listUnlink(mgmt, i);
+		ghostAdd(mgmt, fromT1 ? BM_LIST_B1 : BM_LIST_B2, mgmt->frames[i].pageNum);
+	}
+	return i;
+}
+
+// ARC (Megiddo and Modha): T1 holds pages seen once and T2 pages seen again; hits on the ghosts
+// of recently evicted pages move the target size of T1, so a long scan only cycles through T1
+void ARC(BM_BufferPool *const bm, PageFrame *page) {
+
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	BM_List *lists = mgmt->lists;
+	int c = bm->numPages;
+
+	int g = pageMapGet(&mgmt->ghostMap, page->pageNum);
+	int ghostList = (g == -1) ? -1 : mgmt->nodeList[g];
+	int target = BM_LIST_T1;
+	int i = -1;
+
+	if(ghostList == BM_LIST_B1) {
+		// evicted from T1 too early: grow T1
+		int delta = lists[BM_LIST_B2].size / lists[BM_LIST_B1].size;
+		mgmt->arcTarget += (delta > 1) ? delta : 1;
+		if(mgmt->arcTarget > c) {
+			mgmt->arcTarget = c;
+		}
+		ghostDrop(mgmt, g);
+		target = BM_LIST_T2;
+	}
+	else if(ghostList == BM_LIST_B2) {
+		// evicted from T2 too early: shrink T1
+		int delta = lists[BM_LIST_B1].size / lists[BM_LIST_B2].size;
+		mgmt->arcTarget -= (delta > 1) ? delta : 1;
+		if(mgmt->arcTarget < 0) {
+			mgmt->arcTarget = 0;
+		}
+		ghostDrop(mgmt, g);
+		target = BM_LIST_T2;
+	}
+	else if(lists[BM_LIST_T1].size + lists[BM_LIST_B1].size >= c) {
+		if(lists[BM_LIST_T1].size < c) {
+			ghostDrop(mgmt, lists[BM_LIST_B1].tail);
+		}
+		else {
+			// T1 is the whole pool: its oldest page goes without a ghost
+			i = listVictim(mgmt, BM_LIST_T1);
+			if(i != -1) {
+				listUnlink(mgmt, i);
+			}
+		}
+	}
+	else if(lists[BM_LIST_T1].size + lists[BM_LIST_T2].size + lists[BM_LIST_B1].size + lists[BM_LIST_B2].size >= 2 * c
+			&& lists[BM_LIST_B2].tail != -1) {
+		ghostDrop(mgmt, lists[BM_LIST_B2].tail);
+	}
+
+	if(i == -1 && lists[BM_LIST_FREE].size > 0) {
+		i = lists[BM_LIST_FREE].tail;
+		listUnlink(mgmt, i);
+		mgmt->victimSearchSteps++;
+	}
+	if(i == -1) {
+		i = arcReplace(mgmt, ghostList == BM_LIST_B2);
+	}
+	if(i == -1) {
+		return;
+	}
+
+	// if the found page is dirty, write it back
+	if(pf[i].isDirty == TRUE) {
+		writeBackVictim(bm, i);
+	}
+	placePage(mgmt, i, page);
+	listPushHead(mgmt, target, i);
+}
+
+// 2Q (Johnson and Shasha): first references go through the A1in FIFO; only a page referenced
+// again soon after leaving it (its ghost is still in A1out) enters the Am LRU, so scans stay out of Am
+void TWO_Q(BM_BufferPool *const bm, PageFrame *page) {
+
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	BM_List *lists = mgmt->lists;
+
+	int g = pageMapGet(&mgmt->ghostMap, page->pageNum);
+	int target = BM_LIST_A1IN;
+	if(g != -1) {
+		ghostDrop(mgmt, g);
+		target = BM_LIST_AM;
+	}
+
+	int i;
+	if(lists[BM_LIST_FREE].size > 0) {
+		i = lists[BM_LIST_FREE].tail;
+		listUnlink(mgmt, i);
+		mgmt->victimSearchSteps++;
+	}
+	else {
+		bool fromA1 = lists[BM_LIST_A1IN].size > mgmt->kin;
+		i = listVictim(mgmt, fromA1 ? BM_LIST_A1IN : BM_LIST_AM);
+		if(i == -1) {
+			fromA1 = !fromA1;
+			i = listVictim(mgmt, fromA1 ? BM_LIST_A1IN : BM_LIST_AM);
+		}
+		if(i == -1) {
+			return;
+		}
+		listUnlink(mgmt, i);
+		if(fromA1) {
+			ghostAdd(mgmt, BM_LIST_A1OUT, pf[i].pageNum);
+			if(lists[BM_LIST_A1OUT].size > mgmt->kout) {
+				ghostDrop(mgmt, lists[BM_LIST_A1OUT].tail);
+			}
+		}
+	}
+
+	// if the found page is dirty, write it back
+	if(pf[i].isDirty == TRUE) {
+		writeBackVictim(bm, i);
+	}
+	placePage(mgmt, i, page);
+	listPushHead(mgmt, target, i);
+}
+
+// LRU-K: the unpinned frames are kept in a min-heap on their Kth most recent access time,
+// so the victim is at the top
+void LRU_K(BM_BufferPool *const bm, PageFrame *page) {
+
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+
+	if(mgmt->heapSize == 0) {
+		return;
+	}
+	int LRU_index = mgmt->heap[0];
+	heapRemove(mgmt, LRU_index);
+	mgmt->victimSearchSteps++;
+
+	// if the found page is dirty, write it back
+	if(pf[LRU_index].isDirty == TRUE) {
+		writeBackVictim(bm, LRU_index);
+	}
+	placePage(mgmt, LRU_index, page);
+}
+
+// bucket for use count freq, created if there is none yet; the search starts at bucket b
+// (or the lowest bucket if b is -1) and moves towards higher counts
+static int lfuBucketFor(BM_PoolMgmt *mgmt, int b, int freq) {
+	LFU_Bucket *bk = mgmt->buckets;
+	int prev = -1, cur = (b == -1) ? mgmt->bucketFirst : b;
+	if(cur != -1) {
+		prev = bk[cur].prev;
+	}
+	while(cur != -1 && bk[cur].freq < freq) {
+		prev = cur;
+		cur = bk[cur].next;
+	}
+	if(cur != -1 && bk[cur].freq == freq) {
+		return cur;
+	}
+
+	int nb = mgmt->bucketFree;
+	mgmt->bucketFree = bk[nb].next;
+	bk[nb].freq = freq;
+	bk[nb].head = bk[nb].tail = -1;
+	bk[nb].prev = prev;
+	bk[nb].next = cur;
+	if(prev != -1) {
+		bk[prev].next = nb;
+	}
+	else {
+		mgmt->bucketFirst = nb;
+	}
+	if(cur != -1) {
+		bk[cur].prev = nb;
+	}
+	return nb;
+}
+
+static void lfuReleaseIfEmpty(BM_PoolMgmt *mgmt, int b) {
+	LFU_Bucket *bk = mgmt->buckets;
+	if(bk[b].head != -1) {
+		return;
+	}
+	if(bk[b].prev != -1) {
+		bk[bk[b].prev].next = bk[b].next;
+	}
+	else {
+		mgmt->bucketFirst = bk[b].next;
+	}
+	if(bk[b].next != -1) {
+		bk[bk[b].next].prev = bk[b].prev;
+	}
+	bk[b].next = mgmt->bucketFree;
+	mgmt->bucketFree = b;
+}
+
+static void lfuUnlink(BM_PoolMgmt *mgmt, int i) {
+	PageFrame *pf = mgmt->frames;
+	LFU_Bucket *b = &mgmt->buckets[pf[i].lfuBucket];
+	if(pf[i].lfuPrev != -1) {
+		pf[pf[i].lfuPrev].lfuNext = pf[i].lfuNext;
+	}
+	else {
+		b->head = pf[i].lfuNext;
+	}
+	if(pf[i].lfuNext != -1) {
+		pf[pf[i].lfuNext].lfuPrev = pf[i].lfuPrev;
+	}
+	else {
+		b->tail = pf[i].lfuPrev;
+	}
+}
+
+static void lfuPushHead(BM_PoolMgmt *mgmt, int b, int i) {
+	PageFrame *pf = mgmt->frames;
+	LFU_Bucket *bk = &mgmt->buckets[b];
+	pf[i].lfuBucket = b;
+	pf[i].lfuPrev = -1;
+	pf[i].lfuNext = bk->head;
+	if(bk->head != -1) {
+		pf[bk->head].lfuPrev = i;
+	}
+	else {
+		bk->tail = i;
+	}
+	bk->head = i;
+	pf[i].hitNum = bk->freq;
+}
+
+// moves frame i to the front of the bucket for use count freq
+static void lfuSetCount(BM_PoolMgmt *mgmt, int i, int freq) {
+	int old = mgmt->frames[i].lfuBucket;
+	int b = lfuBucketFor(mgmt, freq > mgmt->buckets[old].freq ? old : -1, freq);
+	lfuUnlink(mgmt, i);
+	lfuPushHead(mgmt, b, i);
+	lfuReleaseIfEmpty(mgmt, old);
+}
+
+// folds bucket src into dst, keeping the combined list ordered by last access
+static void lfuMerge(BM_PoolMgmt *mgmt, int dst, int src) {
+	PageFrame *pf = mgmt->frames;
+	LFU_Bucket *bk = mgmt->buckets;
+	int a = bk[dst].tail, b = bk[src].tail;
+
+	bk[dst].head = bk[dst].tail = -1;
+	bk[src].head = bk[src].tail = -1;
+	while(a != -1 || b != -1) {
+		int x;
+		if(b == -1 || (a != -1 && lastAccess(&pf[a]) <= lastAccess(&pf[b]))) {
+			x = a;
+			a = pf[a].lfuPrev;
+		}
+		else {
+			x = b;
+			b = pf[b].lfuPrev;
+		}
+		lfuPushHead(mgmt, dst, x);
+	}
+	lfuReleaseIfEmpty(mgmt, src);
+}
+
+// halves every page's use count (never below 1), so pages that were hot long ago can be evicted
+static void lfuAge(BM_PoolMgmt *mgmt) {
+	LFU_Bucket *bk = mgmt->buckets;
+	int b = mgmt->bucketFirst;
+	while(b != -1) {
+		int next = bk[b].next;
+		if(bk[b].freq > 1) {
+			bk[b].freq /= 2;
+		}
+		if(bk[b].prev != -1 && bk[bk[b].prev].freq == bk[b].freq) {
+			lfuMerge(mgmt, bk[b].prev, b);
+		}
+		else {
+			for(int i = bk[b].head; i != -1; i = mgmt->frames[i].lfuNext) {
+				mgmt->frames[i].hitNum = bk[b].freq;
+			}
+		}
+		b = next;
+	}
+}
+
+// LFU: frames sit in buckets by use count, each bucket ordered by last access, so the victim is
+// the least recently used unpinned frame of the lowest bucket; empty frames have count 0
+void LFU(BM_BufferPool *const bm, PageFrame *page) {
+
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	LFU_Bucket *bk = mgmt->buckets;
+
+	for(int b = mgmt->bucketFirst; b != -1; b = bk[b].next) {
+		for(int i = bk[b].tail; i != -1; i = pf[i].lfuPrev) {
+			mgmt->victimSearchSteps++;
+			if(pf[i].fixCount == 0) {
+				// if the found page is dirty, write it back
+				if(pf[i].isDirty == TRUE) {
+					writeBackVictim(bm, i);
+				}
+				placePage(mgmt, i, page);
+				lfuSetCount(mgmt, i, 1);
+				return;
+			}
+		}
+	}
+}
+
+// empties frame i, whose page could not be read, and puts it back where the strategy keeps
+// empty frames, so the next pin of the page misses and reads it again. The caller holds a fix on
+// the frame (so it is in no LRU-K heap) and drops it afterwards
+static void unmapFrame(BM_BufferPool *const bm, int i) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+
+	pageMapRemove(&mgmt->frameMap, pf[i].pageNum);
+	countFileFrames(mgmt, i, pf[i].pageNum, NO_PAGE);
+	pf[i].pageNum = NO_PAGE;
+	pf[i].isDirty = FALSE;
+	pf[i].prefetched = FALSE;
+	pf[i].hitNum = 0;
+
+	switch(bm->strategy) {
+		case RS_LRU:
+			listUnlink(mgmt, i);
+			listPushTail(mgmt, BM_LIST_LRU, i);
+			break;
+		case RS_ARC:
+		case RS_2Q:
+			listUnlink(mgmt, i);
+			listPushHead(mgmt, BM_LIST_FREE, i);
+			break;
+		case RS_CLOCK_PRO:
+			if(mgmt->cpFlags[i] & CP_HOT) {
+				mgmt->cpHot--;
+			}
+			mgmt->cpFlags[i] = 0;
+			ringRemove(mgmt, i);
+			listPushHead(mgmt, BM_LIST_FREE, i);
+			break;
+		case RS_LFU:
+			lfuSetCount(mgmt, i, 0);
+			break;
+		default:
+			break;
+	}
+}
+
+// a miss could not read its page into frame i: the frame is emptied and the pin it took given up
+static void failPin(BM_BufferPool *const bm, int i) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	unmapFrame(bm, i);
+	mgmt->frames[i].fixCount = 0;
+	mgmt->pinnedFrames--;
+	if(bm->strategy == RS_LRU_K) {
+		heapInsert(mgmt, i);
+	}
+	pthread_cond_broadcast(&mgmt->frameFreed);
+}
+
+// a prefetch read finished: drop the prefetch's fix on the frame
+static void completePrefetch(BM_BufferPool *const bm, SM_AsyncRequest *req) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *frame = (PageFrame *) req->userData;
+
+	// the page is known to exist, so retry a failed read synchronously; if that fails too the
+	// frame is emptied so the next pin takes the miss path and reports the error
+	if(req->rc != RC_OK && poolRead(mgmt, frame->pageNum, frame->data) != RC_OK) {
+		unmapFrame(bm, (int)(frame - mgmt->frames));
+	}
+	frame->ioPending = FALSE;
+	mgmt->prefetchInFlight--;
+	if(--frame->fixCount == 0) {
+		mgmt->pinnedFrames--;
+		if(bm->strategy == RS_LRU_K) {
+			heapInsert(mgmt, (int)(frame - mgmt->frames));
+		}
+	}
+}
+
+// reaps at least minCompleted finished async requests, routing them by userData: prefetches
+// carry their frame, a miss's read into the spare carries NULL and sets spareDone
+static void reapAsync(BM_BufferPool *const bm, int minCompleted) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	SM_AsyncRequest *done[BM_ASYNC_QUEUE_DEPTH];
+
+	int n = waitAsyncIO(mgmt->aio, done, BM_ASYNC_QUEUE_DEPTH, minCompleted);
+	for(int k = 0; k < n; k++) {
+		if(done[k]->userData == NULL) {
+			mgmt->spareDone = TRUE;
+		}
+		else {
+			completePrefetch(bm, done[k]);
+		}
+	}
+}
+
+// the frame holding key once no I/O on the page is in flight, or -1 if the page is not in the
+// pool: waits out a prefetch into it (reaping it), a miss loading it and the write-back of it by
+// the miss that evicted it. The latch is released while waiting for another thread's I/O
+static int waitForPage(BM_BufferPool *const bm, PageNumber key) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	while(1) {
+		int i = lookupFrame(mgmt, key);
+		if(i != -1 && mgmt->frames[i].ioPending) {
+			reapAsync(bm, 1);
+		}
+		else if((i != -1 && mgmt->frames[i].loading) || pageMapGet(&mgmt->wbMap, key) != -1) {
+			pthread_cond_wait(&mgmt->ioDone, &mgmt->lock);
+		}
+		else {
+			return i;
+		}
+	}
+}
+
+// fixes frame i for a write done with the latch released, so no strategy evicts it meanwhile
+static void fixForWrite(BM_BufferPool *const bm, int i) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	if(mgmt->frames[i].fixCount++ == 0) {
+		mgmt->pinnedFrames++;
+		if(bm->strategy == RS_LRU_K) {
+			heapRemove(mgmt, i);
+		}
+	}
+	mgmt->ioInFlight++;
+	mgmt->writesInFlight++;
+}
+
+// drops the fix fixForWrite took once its write is done
+static void unfixAfterWrite(BM_BufferPool *const bm, int i) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	mgmt->ioInFlight--;
+	mgmt->writesInFlight--;
+	if(--mgmt->frames[i].fixCount == 0) {
+		mgmt->pinnedFrames--;
+		if(bm->strategy == RS_LRU_K) {
+			heapInsert(mgmt, i);
+		}
+		pthread_cond_broadcast(&mgmt->frameFreed);
+	}
+	pthread_cond_broadcast(&mgmt->ioDone);
+}
+
+// the I/O of a miss that placed key in frame i (pinned for the caller), done with the latch
+// released: the page the strategy evicted from the frame (victim, NO_PAGE if it was clean) is
+// written back, then key is read in unless read is FALSE. With an async engine and a victim to
+// write, the read goes into the spare while the write runs. Returns with the latch held again
+static RC loadFrame(BM_BufferPool *const bm, int i, PageNumber key, PageNumber victim, bool read) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	// a resize waits for ioInFlight to drop to zero, so the frames stay where they are
+	PageFrame *pf = mgmt->frames;
+
+	pf[i].loading = TRUE;
+	mgmt->ioInFlight++;
+	if(victim != NO_PAGE) {
+		pageMapPut(&mgmt->wbMap, victim, i);
+		mgmt->writesInFlight++;
+	}
+
+	SM_AsyncRequest readReq;
+	bool async = read && victim != NO_PAGE && mgmt->spare != NULL && !mgmt->spareBusy;
+	if(async) {
+		poolEnsurePage(mgmt, key);
+		mgmt->spareBusy = TRUE;
+		mgmt->spareDone = FALSE;
+		poolAsyncRead(mgmt, key, mgmt->spare, &readReq);
+		readReq.userData = NULL;
+		queueAsyncIO(mgmt->aio, &readReq);
+		submitAsyncIO(mgmt->aio);
+	}
+	pthread_mutex_unlock(&mgmt->lock);
+
+	RC rc = RC_OK;
+	if(victim != NO_PAGE) {
+		poolWrite(mgmt, victim, pf[i].data);
+	}
+	if(read && !async) {
+		poolEnsurePage(mgmt, key);
+		rc = poolRead(mgmt, key, pf[i].data);
+	}
+
+	pthread_mutex_lock(&mgmt->lock);
+	if(async) {
+		// any thread driving the engine may have reaped the read already
+		while(!mgmt->spareDone) {
+			reapAsync(bm, 1);
+		}
+		// the page was read into the spare; the victim's old buffer becomes the next spare
+		SM_PageHandle data = mgmt->spare;
+		mgmt->spare = pf[i].data;
+		pf[i].data = data;
+		mgmt->spareBusy = FALSE;
+		// a request the engine could not submit (or that failed) is retried synchronously
+		if(readReq.rc != RC_OK) {
+			pthread_mutex_unlock(&mgmt->lock);
+			rc = poolRead(mgmt, key, pf[i].data);
+			pthread_mutex_lock(&mgmt->lock);
+		}
+	}
+	if(victim != NO_PAGE) {
+		pageMapRemove(&mgmt->wbMap, victim);
+		mgmt->writesInFlight--;
+	}
+	pf[i].loading = FALSE;
+	mgmt->ioInFlight--;
+	pthread_cond_broadcast(&mgmt->ioDone);
+	return rc;
+}
+
+static int compareDirtyPages(const void *a, const void *b) {
+	PageNumber x = ((const BM_DirtyPage *) a)->pageNum, y = ((const BM_DirtyPage *) b)->pageNum;
+	return (x > y) - (x < y);
+}
+
+// writes back the frames in dirty (sorted by compareDirtyPages) with one vectored write per
+// file, so runs of adjacent pages go out as single writes. Called with the latch held, which is
+// released for the writes: the frames are fixed and marked clean first, and marked dirty again
+// if their file's write fails. With latch set each page's content latch is held shared during
+// the write; pages someone holds exclusively (is changing) are left out, the ones written are
+// moved to the first *count slots of dirty and counted in *count
+static RC writeDirtyPages(BM_BufferPool *const bm, BM_DirtyPage *dirty, int *count, bool latch) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	int n = 0;
+	for(int j = 0; j < *count; j++) {
+		if(!latch || pthread_rwlock_tryrdlock(pf[dirty[j].frame].latch) == 0) {
+			dirty[n++] = dirty[j];
+		}
+	}
+	*count = n;
+	PageNumber *pageNums = (PageNumber *) malloc((n > 0 ? n : 1) * sizeof(PageNumber));
+	SM_PageHandle *data = (SM_PageHandle *) malloc((n > 0 ? n : 1) * sizeof(SM_PageHandle));
+	RC rc = RC_OK;
+
+	for(int j = 0; j < n; j++) {
+		fixForWrite(bm, dirty[j].frame);
+		pf[dirty[j].frame].isDirty = FALSE;
+		pageNums[j] = BM_PAGE_OF(dirty[j].pageNum);
+		data[j] = pf[dirty[j].frame].data;
+	}
+	pthread_mutex_unlock(&mgmt->lock);
+
+	// a failed file's pages get a NULL buffer
+	int first = 0;
+	while(first < n) {
+		int f = BM_FILE_OF(dirty[first].pageNum);
+		int count = 0;
+		while(first + count < n && BM_FILE_OF(dirty[first + count].pageNum) == f) {
+			count++;
+		}
+		RC writeRc = poolWriteList(mgmt, f, pageNums + first, count, data + first);
+		if(writeRc != RC_OK) {
+			memset(data + first, 0, count * sizeof(SM_PageHandle));
+			rc = (rc == RC_OK) ? writeRc : rc;
+		}
+		first += count;
+	}
+
+	pthread_mutex_lock(&mgmt->lock);
+	for(int j = 0; j < n; j++) {
+		if(latch) {
+			pthread_rwlock_unlock(pf[dirty[j].frame].latch);
+		}
+		if(data[j] == NULL) {
+			pf[dirty[j].frame].isDirty = TRUE;
+		}
+		else {
+			mgmt->writeCnt++;
+		}
+		unfixAfterWrite(bm, dirty[j].frame);
+	}
+
+	free(pageNums);
+	free(data);
+	return rc;
+}
+
+// rank[i] is how soon replacement would take frame i, lower first: the position ahead of the
+// FIFO or CLOCK hand (a GCLOCK counter costs one more turn), from the evicting end of the LRU, LFU,
+// ARC and 2Q lists, the Kth access time for LRU-K, and the distance ahead of the CLOCK-Pro cold
+// hand (a turn more for a referenced cold page, two for a hot one). Empty frames are not ranked
+static void evictionRanks(BM_BufferPool *const bm, long *rank) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	BM_List *lists = mgmt->lists;
+	int n = bm->numPages;
+	long pos = 0;
+
+	switch(bm->strategy) {
+		case RS_FIFO:
+			for(int i = 0; i < n; i++) {
+				rank[i] = (i - mgmt->front + n) % n;
+			}
+			break;
+		case RS_CLOCK:
+			for(int i = 0; i < n; i++) {
+				rank[i] = (long) pf[i].hitNum * n + (i - mgmt->clock % n + n) % n;
+			}
+			break;
+		case RS_LRU:
+			for(int i = lists[BM_LIST_LRU].tail; i != -1; i = mgmt->nodePrev[i]) {
+				rank[i] = pos++;
+			}
+			break;
+		case RS_LRU_K:
+			for(int i = 0; i < n; i++) {
+				rank[i] = kthAccess(mgmt, &pf[i]);
+			}
+			break;
+		case RS_LFU:
+			for(int b = mgmt->bucketFirst; b != -1; b = mgmt->buckets[b].next) {
+				for(int i = mgmt->buckets[b].tail; i != -1; i = pf[i].lfuPrev) {
+					rank[i] = pos++;
+				}
+			}
+			break;
+		case RS_ARC:
+		case RS_2Q: {
+			// replay which list the evictions would come from
+			int first = (bm->strategy == RS_ARC) ? BM_LIST_T1 : BM_LIST_A1IN;
+			int second = (bm->strategy == RS_ARC) ? BM_LIST_T2 : BM_LIST_AM;
+			int target = (bm->strategy == RS_ARC) ? mgmt->arcTarget : mgmt->kin;
+			int a = lists[first].tail, b = lists[second].tail, size = lists[first].size;
+			while(a != -1 || b != -1) {
+				if(a != -1 && (b == -1 || size > target)) {
+					rank[a] = pos++;
+					a = mgmt->nodePrev[a];
+					size--;
+				}
+				else {
+					rank[b] = pos++;
+					b = mgmt->nodePrev[b];
+				}
+			}
+			break;
+		}
+		case RS_CLOCK_PRO: {
+			int len = n + mgmt->cpGhosts, node = mgmt->handCold;
+			for(int d = 0; node != -1 && d < len; d++, node = mgmt->nodeNext[node]) {
+				if(node < n) {
+					rank[node] = d + ((mgmt->cpFlags[node] & CP_HOT) ? 2L * len : (pf[node].hitNum > 0) ? len : 0);
+				}
+			}
+			break;
+		}
+	}
+}
+
+static int compareDirtyRanks(const void *a, const void *b) {
+	long x = ((const BM_DirtyPage *) a)->rank, y = ((const BM_DirtyPage *) b)->rank;
+	return (x > y) - (x < y);
+}
+
+// one background writer round, called with the latch held: once more than bgDirtyHigh percent
+// of the frames are dirty, write back the dirty unpinned frames replacement would take next
+// (see evictionRanks) until bgDirtyLow percent are left or bgMaxWrites pages are written. They
+// go out in page-number order, one run of adjacent pages at a time with the latch released, so
+// foreground calls are never held up by a write
+static void bgWriteRound(BM_BufferPool *const bm, BM_DirtyPage *dirty, long *rank) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+
+	int n = 0, dirtyCount = 0;
+	for(int i = 0; i < bm->numPages; i++) {
+		if(pf[i].isDirty == TRUE) {
+			dirtyCount++;
+			if(pf[i].fixCount == 0) {
+				dirty[n].pageNum = pf[i].pageNum;
+				dirty[n++].frame = i;
+			}
+		}
+	}
+	if(dirtyCount * 100 <= mgmt->bgDirtyHigh * bm->numPages) {
+		return;
+	}
+
+	// the pages to write this round: the ones closest to eviction
+	int want = dirtyCount - mgmt->bgDirtyLow * bm->numPages / 100;
+	if(mgmt->bgMaxWrites > 0 && want > mgmt->bgMaxWrites) {
+		want = mgmt->bgMaxWrites;
+	}
+	if(want <= 0) {
+		return;
+	}
+	if(n > want) {
+		evictionRanks(bm, rank);
+		for(int j = 0; j < n; j++) {
+			dirty[j].rank = rank[dirty[j].frame];
+		}
+		qsort(dirty, n, sizeof(BM_DirtyPage), compareDirtyRanks);
+		n = want;
+	}
+	qsort(dirty, n, sizeof(BM_DirtyPage), compareDirtyPages);
+
+	// each write covers one run of adjacent pages and is done with the latch freed
+	int j = 0;
+	while(j < n && !mgmt->bgStop) {
+		int start = j, m = 0;
+		pf = mgmt->frames;
+		for(; j < n; j++) {
+			// while the latch was free for the last write the frame may have been replaced, pinned
+			// or written, or the pool resized
+			int i = dirty[j].frame;
+			if(i >= bm->numPages || pf[i].pageNum != dirty[j].pageNum
+					|| pf[i].isDirty == FALSE || pf[i].fixCount > 0) {
+				continue;
+			}
+			if(m > 0 && dirty[j].pageNum != dirty[start + m - 1].pageNum + 1) {
+				break;
+			}
+			dirty[start + m++] = dirty[j];
+		}
+		if(m == 0) {
+			break;
+		}
+		writeDirtyPages(bm, dirty + start, &m, TRUE);
+	}
+}
+
+// the absolute time ms milliseconds from now, for pthread_cond_timedwait
+static void deadlineAfter(struct timespec *deadline, int ms) {
+	clock_gettime(CLOCK_REALTIME, deadline);
+	deadline->tv_sec += ms / 1000;
+	deadline->tv_nsec += (long)(ms % 1000) * 1000000L;
+	if(deadline->tv_nsec >= 1000000000L) {
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000L;
+	}
+}
+
+static void *bgWriterMain(void *arg) {
+	BM_BufferPool *bm = (BM_BufferPool *) arg;
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	int capacity = 0;
+	BM_DirtyPage *dirty = NULL;
+	long *rank = NULL;
+
+	pthread_mutex_lock(&mgmt->lock);
+	while(!mgmt->bgStop) {
+		struct timespec deadline;
+		deadlineAfter(&deadline, mgmt->bgIntervalMs);
+		pthread_cond_timedwait(&mgmt->bgWake, &mgmt->lock, &deadline);
+		// the pool may have grown since the last round
+		if(capacity < bm->numPages) {
+			capacity = bm->numPages;
+			dirty = (BM_DirtyPage *) realloc(dirty, capacity * sizeof(BM_DirtyPage));
+			rank = (long *) realloc(rank, capacity * sizeof(long));
+		}
+		if(!mgmt->bgStop) {
+			bgWriteRound(bm, dirty, rank);
+		}
+	}
+	pthread_mutex_unlock(&mgmt->lock);
+
+	free(dirty);
+	free(rank);
+	return NULL;
+}
+
+static void replacePage(BM_BufferPool *const bm, PageFrame *page);
+
+// a resident page and its priority under the pool's strategy: pages with a higher class, and
+// within a class a higher rank, are the ones the strategy would keep longest
+typedef struct BM_WarmPage {
+	PageNumber pageNum;
+	int cls, rank;
+} BM_WarmPage;
+
+// pages the warm-up loader reads (sorted, with one vectored call) under one shard latch
+#define BM_WARMUP_BATCH 32
+
+// manifest file: BM_MANIFEST_MAGIC, the number of pages, then their page numbers, hottest first
+#define BM_MANIFEST_MAGIC 0x4D57424D
+
+static void warmPriority(BM_BufferPool *const bm, int i, BM_WarmPage *wp) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *frame = &mgmt->frames[i];
+	wp->pageNum = frame->pageNum;
+	wp->cls = 0;
+	wp->rank = lastAccess(frame);
+	switch(bm->strategy) {
+		case RS_FIFO:
+			// the newest page is the one just before the queue's front
+			wp->rank = (i - mgmt->front + bm->numPages) % bm->numPages;
+			break;
+		case RS_CLOCK:
+		case RS_LFU:
+			wp->cls = frame->hitNum;
+			break;
+		case RS_LRU_K:
+			wp->cls = kthAccess(mgmt, frame);
+			break;
+		case RS_ARC:
+			wp->cls = (mgmt->nodeList[i] == BM_LIST_T2);
+			break;
+		case RS_2Q:
+			wp->cls = (mgmt->nodeList[i] == BM_LIST_AM);
+			break;
+		case RS_CLOCK_PRO:
+			wp->cls = (mgmt->cpFlags[i] & CP_HOT) != 0;
+			break;
+		default:
+			break;
+	}
+}
+
+static int compareWarmPages(const void *a, const void *b) {
+	const BM_WarmPage *x = (const BM_WarmPage *) a, *y = (const BM_WarmPage *) b;
+	if(x->cls != y->cls) {
+		return (x->cls < y->cls) - (x->cls > y->cls);
+	}
+	return (x->rank < y->rank) - (x->rank > y->rank);
+}
+
+static int comparePageNumbers(const void *a, const void *b) {
+	PageNumber x = *(const PageNumber *) a, y = *(const PageNumber *) b;
+	return (x > y) - (x < y);
+}
+
+// writes the pool's resident pages to its manifest, hottest first; the file is replaced only
+// once the new one is complete. Warm-up is only an optimization, so failures are ignored
+static void writeManifest(BM_BufferPool *const pool) {
+	BM_PoolMgmt *top = (BM_PoolMgmt *) pool->mgmtData;
+	BM_WarmPage *pages = (BM_WarmPage *) malloc(pool->numPages * sizeof(BM_WarmPage));
+	int n = 0;
+	for(int s = 0; s < top->numShards; s++) {
+		BM_BufferPool *shard = shardAt(pool, s);
+		BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shard->mgmtData;
+		pthread_mutex_lock(&mgmt->lock);
+		for(int i = 0; i < shard->numPages; i++) {
+			if(mgmt->frames[i].pageNum != NO_PAGE) {
+				warmPriority(shard, i, &pages[n++]);
+			}
+		}
+		pthread_mutex_unlock(&mgmt->lock);
+	}
+	qsort(pages, n, sizeof(BM_WarmPage), compareWarmPages);
+
+	char *tmp = (char *) malloc(strlen(top->manifest) + 5);
+	sprintf(tmp, "%s.tmp", top->manifest);
+	FILE *f = fopen(tmp, "wb");
+	if(f != NULL) {
+		uint32_t header[2] = { BM_MANIFEST_MAGIC, (uint32_t) n };
+		bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+		for(int k = 0; k < n && ok; k++) {
+			int64_t pageNum = pages[k].pageNum;
+			ok = fwrite(&pageNum, sizeof(pageNum), 1, f) == 1;
+		}
+		if(fclose(f) == 0 && ok) {
+			rename(tmp, top->manifest);
+		}
+		else {
+			remove(tmp);
+		}
+	}
+	free(tmp);
+	free(pages);
+}
+
+// the first (hottest) max pages of a manifest, or 0 if there is no valid one
+static int readManifest(const char *path, int max, PageNumber **pages) {
+	*pages = NULL;
+	FILE *f = fopen(path, "rb");
+	if(f == NULL) {
+		return 0;
+	}
+	uint32_t header[2];
+	int n = 0;
+	if(fread(header, sizeof(header), 1, f) == 1 && header[0] == BM_MANIFEST_MAGIC) {
+		int count = (header[1] < (uint32_t) max) ? (int) header[1] : max;
+		*pages = (PageNumber *) malloc((count > 0 ? count : 1) * sizeof(PageNumber));
+		int64_t pageNum;
+		while(n < count && fread(&pageNum, sizeof(pageNum), 1, f) == 1) {
+			if(BM_PAGE_IN_RANGE(pageNum)) {
+				(*pages)[n++] = pageNum;
+			}
+		}
+	}
+	fclose(f);
+	return n;
+}
+
+// places page in the empty frame i with the bookkeeping the strategy does for a page it placed
+// itself. CLOCK's hand, and in general the victim searches, may pick a resident page before an
+// empty frame, so the frame is chosen here; only FIFO, ARC, 2Q and CLOCK-Pro place the page
+// themselves, as they take an empty frame (FIFO's first, or their free list's) while there is one
+static void warmPlace(BM_BufferPool *const bm, int i, PageFrame *page) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	switch(bm->strategy) {
+		case RS_LRU:
+			placePage(mgmt, i, page);
+			listMoveHead(mgmt, BM_LIST_LRU, i);
+			break;
+		case RS_CLOCK:
+			placePage(mgmt, i, page);
+			mgmt->frames[i].hitNum = 1;
+			break;
+		case RS_LFU:
+			placePage(mgmt, i, page);
+			lfuSetCount(mgmt, i, 1);
+			break;
+		case RS_LRU_K:
+			heapRemove(mgmt, i);
+			placePage(mgmt, i, page);
+			break;
+		default:
+			replacePage(bm, page);
+			break;
+	}
+}
+
+// loads the batch's pages of shard s into its empty frames with one vectored read, done with the
+// latch released; the frames stay pinned and loading (pins of their pages wait) until the read is
+// done. Resident pages are never evicted for a warm page, nor pages still being written back
+static RC warmShard(BM_BufferPool *const pool, int s, PageNumber *batch, int count) {
+	BM_BufferPool *bm = shardAt(pool, s);
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageNumber pageNums[BM_WARMUP_BATCH];
+	SM_PageHandle data[BM_WARMUP_BATCH];
+	int frames[BM_WARMUP_BATCH];
+	int m = 0;
+
+	pthread_mutex_lock(&mgmt->lock);
+	// frames before this one are known to be in use
+	int empty = 0;
+	for(int k = 0; k < count; k++) {
+		PageNumber pageNum = batch[k];
+		if(shardIndex(pool, pageNum) != s || !poolHasPage(mgmt, pageNum)
+				|| lookupFrame(mgmt, pageNum) != -1 || pageMapGet(&mgmt->wbMap, pageNum) != -1) {
+			continue;
+		}
+		while(empty < bm->numPages && mgmt->frames[empty].pageNum != NO_PAGE) {
+			empty++;
+		}
+		if(empty == bm->numPages) {
+			break;
+		}
+		PageFrame newPage;
+		newPage.pageNum = pageNum;
+		newPage.isDirty = 0;
+		newPage.fixCount = 1;
+		newPage.hitNum = 0;
+		mgmt->deferWriteBack = TRUE;
+		mgmt->victimKey = NO_PAGE;
+		warmPlace(bm, empty, &newPage);
+		mgmt->deferWriteBack = FALSE;
+		int i = lookupFrame(mgmt, pageNum);
+		if(i == -1) {
+			break;
+		}
+		// the strategies take empty frames first, but should one have evicted a dirty page
+		// instead, it is written back before the read
+		if(mgmt->victimKey != NO_PAGE) {
+			loadFrame(bm, i, pageNum, mgmt->victimKey, FALSE);
+		}
+		mgmt->frames[i].loading = TRUE;
+		mgmt->ioInFlight++;
+		pageNums[m] = pageNum;
+		frames[m++] = i;
+	}
+
+	// ioInFlight keeps a resize from moving the frames while the latch is free
+	for(int k = 0; k < m; k++) {
+		data[k] = mgmt->frames[frames[k]].data;
+	}
+	pthread_mutex_unlock(&mgmt->lock);
+	RC rc = RC_OK;
+	if(m > 0) {
+		rc = poolReadList(mgmt, 0, pageNums, m, data);
+	}
+	pthread_mutex_lock(&mgmt->lock);
+
+	mgmt->readCnt += (rc == RC_OK) ? m : 0;
+	for(int k = 0; k < m; k++) {
+		int i = frames[k];
+		// a failed read leaves stale data in the frames, which must not become hits
+		if(rc != RC_OK) {
+			unmapFrame(bm, i);
+		}
+		mgmt->frames[i].loading = FALSE;
+		mgmt->ioInFlight--;
+		if(--mgmt->frames[i].fixCount == 0) {
+			mgmt->pinnedFrames--;
+			if(bm->strategy == RS_LRU_K) {
+				heapInsert(mgmt, i);
+			}
+		}
+	}
+	if(m > 0) {
+		pthread_cond_broadcast(&mgmt->ioDone);
+		pthread_cond_broadcast(&mgmt->frameFreed);
+	}
+	pthread_mutex_unlock(&mgmt->lock);
+	return rc;
+}
+
+// warm-up loader: reads the manifest's pages hottest batch first, each batch in page order so
+// that runs of adjacent pages become one read; it only fills frames it finds empty (see
+// warmShard), so it never pushes out pages the pool's users have brought in meanwhile
+static void *warmupMain(void *arg) {
+	BM_BufferPool *pool = (BM_BufferPool *) arg;
+	BM_PoolMgmt *top = (BM_PoolMgmt *) pool->mgmtData;
+
+	for(int start = 0; start < top->warmCount; start += BM_WARMUP_BATCH) {
+		pthread_mutex_lock(&top->warmLock);
+		bool stop = top->warmStop;
+		pthread_mutex_unlock(&top->warmLock);
+		if(stop) {
+			break;
+		}
+		int count = top->warmCount - start;
+		if(count > BM_WARMUP_BATCH) {
+			count = BM_WARMUP_BATCH;
+		}
+		PageNumber *batch = top->warmPages + start;
+		qsort(batch, count, sizeof(PageNumber), comparePageNumbers);
+		// a read error (the file shrank, an I/O error) ends the warm-up
+		RC rc = RC_OK;
+		for(int s = 0; s < top->numShards && rc == RC_OK; s++) {
+			rc = warmShard(pool, s, batch, count);
+		}
+		if(rc != RC_OK) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+// remembers the pool's manifest and, if it holds pages, starts the loader
+static void startWarmup(BM_BufferPool *const bm, const char *manifest) {
+	BM_PoolMgmt *top = (BM_PoolMgmt *) bm->mgmtData;
+	top->manifest = strdup(manifest);
+	top->warmCount = readManifest(manifest, bm->numPages, &top->warmPages);
+	top->warmStop = FALSE;
+	pthread_mutex_init(&top->warmLock, NULL);
+	top->warmRunning = top->warmCount > 0
+			&& pthread_create(&top->warmThread, NULL, warmupMain, bm) == 0;
+}
+
+static void stopWarmup(BM_BufferPool *const bm) {
+	BM_PoolMgmt *top = (BM_PoolMgmt *) bm->mgmtData;
+	if(top->warmRunning) {
+		pthread_mutex_lock(&top->warmLock);
+		top->warmStop = TRUE;
+		pthread_mutex_unlock(&top->warmLock);
+		pthread_join(top->warmThread, NULL);
+		top->warmRunning = FALSE;
+	}
+}
+
+// default settings used by initBufferPool
+void initPoolConfig(BM_PoolConfig *config) {
+	config->ioMode = SM_IO_PREAD;
+	config->useAsyncIO = FALSE;
+	config->lfuAgingInterval = 0;
+	config->clockMaxCount = BM_CLOCK_MAX_COUNT;
+	config->backgroundWriter = FALSE;
+	config->bgDirtyHighPercent = 20;
+	config->bgDirtyLowPercent = 5;
+	config->bgMaxWritesPerRound = 32;
+	config->bgIntervalMs = 50;
+	config->numShards = 1;
+	config->pinWaitTimeoutMs = 0;
+	config->warmupManifest = NULL;
+	config->syncOnFlush = FALSE;
+}
+
+RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
+        const int numPages, ReplacementStrategy strategy,
+        void *stratData) {
+	return initBufferPoolWithConfig(bm, pageFileName, numPages, strategy, stratData, NULL);
+}
+
+// writes back the dirty, unpinned frames of one pool or shard; only those holding pages of
+// file fileId unless it is -1
+static RC flushFrames(BM_BufferPool *const bm, int fileId) {
+    BM_PoolMgmt *mgmt = (BM_PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&mgmt->lock);
+    PageFrame *pf = mgmt->frames;
+    BM_DirtyPage *dirty = (BM_DirtyPage *) malloc(bm->numPages * sizeof(BM_DirtyPage));
+    int n = 0;
+    for(int i = 0; i < bm->numPages; i++) {
+		if(pf[i].fixCount == 0 && pf[i].isDirty == TRUE
+				&& (fileId == -1 || BM_FILE_OF(pf[i].pageNum) == fileId))
+		{
+			dirty[n].pageNum = pf[i].pageNum;
+			dirty[n++].frame = i;
+        }
+    }
+    // in page order, so adjacent pages are written together and the disk sees one sweep
+    qsort(dirty, n, sizeof(BM_DirtyPage), compareDirtyPages);
+    RC rc = writeDirtyPages(bm, dirty, &n, TRUE);
+    // pages other threads are writing back were skipped above; they are on disk once those finish
+    while(mgmt->writesInFlight > 0) {
+        pthread_cond_wait(&mgmt->ioDone, &mgmt->lock);
+    }
+    pthread_mutex_unlock(&mgmt->lock);
+
+    free(dirty);
+    return rc;
+}
+
+// stops the background writer, writes dirty pages back and frees the frames and replacement
+// state of one pool or shard; the page file stays open
+static void freeFrames(BM_BufferPool *const bm) {
+    BM_PoolMgmt *mgmt = (BM_PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&mgmt->lock);
+    mgmt->bgStop = TRUE;
+    pthread_cond_signal(&mgmt->bgWake);
+    pthread_mutex_unlock(&mgmt->lock);
+    if(mgmt->bgRunning) {
+        pthread_join(mgmt->bgThread, NULL);
+    }
+
+    // write back dirty pages before shutting down
+    flushFrames(bm, -1);
+
+    if(mgmt->aio != NULL) {
+        shutdownAsyncIO(mgmt->aio);
+    }
+
+    // free allocated pages
+    chunkFreeAll(mgmt);
+    free(mgmt->frames);
+    free(mgmt->history);
+    free(mgmt->heap);
+    free(mgmt->heapPos);
+    free(mgmt->buckets);
+    pageMapFree(&mgmt->frameMap);
+    pageMapFree(&mgmt->wbMap);
+    pageMapFree(&mgmt->ghostMap);
+    free(mgmt->fileNext);
+    free(mgmt->filePrev);
+    free(mgmt->fileHead);
+    free(mgmt->fileTail);
+    free(mgmt->nodePrev);
+    free(mgmt->nodeNext);
+    free(mgmt->nodeList);
+    free(mgmt->ghostPages);
+    free(mgmt->cpFlags);
+    free(mgmt->prefetchReqs);
+    pthread_mutex_destroy(&mgmt->lock);
+    pthread_cond_destroy(&mgmt->ioDone);
+    pthread_cond_destroy(&mgmt->bgWake);
+    pthread_cond_destroy(&mgmt->frameFreed);
+}
+
+// sets up the frames and replacement state of one pool or shard (bm->numPages frames) in mgmt,
+// whose file table is already set, and makes it bm's mgmtData
+static RC initFrames(BM_BufferPool *const bm, BM_PoolMgmt *mgmt, void *stratData,
+        const BM_PoolConfig *config) {
+	int numPages = bm->numPages;
+	ReplacementStrategy strategy = bm->strategy;
+	mgmt->numShards = 1;
+	mgmt->shards = NULL;
+	mgmt->cache = NULL;
+	mgmt->fileId = -1;
+	mgmt->manifest = NULL;
+	mgmt->warmPages = NULL;
+
+	// every pool has its own replacement state and counters, so pools for different files coexist
+	mgmt->front = 0;
+	mgmt->rear = -1;
+	mgmt->clock = 0;
+	mgmt->globalHitCount = 0;
+	mgmt->writeCnt = mgmt->readCnt = 0;
+	mgmt->hits = mgmt->misses = mgmt->cleanEvictions = mgmt->dirtyEvictions = 0;
+	mgmt->pinWaits = mgmt->failedPins = mgmt->victimSearches = mgmt->victimSearchSteps = 0;
+
+	if(stratData == NULL) {
+		mgmt->K = 1;
+	}
+	else {
+		mgmt->K = *((int *)(stratData));
+	}
+
+	// without an engine the pool simply stays synchronous
+	mgmt->aio = NULL;
+	if(config->useAsyncIO && initAsyncIO(&mgmt->aio, BM_ASYNC_QUEUE_DEPTH, SM_AIO_AUTO) != RC_OK) {
+		mgmt->aio = NULL;
+	}
+
+	// all page memory is allocated here (or by a resize), in one chunk, so pinPage never allocates;
+	// an async pool gets one extra page to read into while the victim is still being written back
+	mgmt->chunks = NULL;
+	BM_FrameChunk *chunk = chunkAlloc(mgmt, numPages + (mgmt->aio != NULL ? 1 : 0));
+	if(chunk == NULL) {
+		if(mgmt->aio != NULL) {
+			shutdownAsyncIO(mgmt->aio);
+		}
+		return RC_WRITE_FAILED;
+	}
+	mgmt->spare = (mgmt->aio != NULL) ? chunk->data + (size_t)numPages * mgmt->files->pageSize : NULL;
+	mgmt->history = (int *) calloc((size_t)numPages * mgmt->K, sizeof(int));
+
+    // zero initalize everything
+    PageFrame *pf = malloc(numPages * sizeof(PageFrame));
+
+	for(int i = 0; i < numPages; i++) {
+		frameInit(&pf[i], chunk->data + (size_t)i * mgmt->files->pageSize, &chunk->latches[i],
+				mgmt->history + (size_t)i * mgmt->K);
+	}
+	mgmt->frames = pf;
+	mgmt->prefetchReqs = (SM_AsyncRequest *) malloc(numPages * sizeof(SM_AsyncRequest));
+	mgmt->prefetchInFlight = 0;
+	// leave room in the queue for pinPage's own read and never prefetch over half the pool
+	mgmt->prefetchLimit = (numPages / 2 < BM_ASYNC_QUEUE_DEPTH - 1) ? numPages / 2 : BM_ASYNC_QUEUE_DEPTH - 1;
+	if(mgmt->prefetchLimit < 1) {
+		mgmt->prefetchLimit = 1;
+	}
+
+	// empty frames go in victim order: frame 0 is at the tail of the list and the heap's top
+	for(int l = 0; l < BM_NUM_LISTS; l++) {
+		mgmt->lists[l].head = mgmt->lists[l].tail = -1;
+		mgmt->lists[l].size = 0;
+	}
+	mgmt->nodePrev = (int *) malloc(2 * numPages * sizeof(int));
+	mgmt->nodeNext = (int *) malloc(2 * numPages * sizeof(int));
+	mgmt->nodeList = (int *) malloc(2 * numPages * sizeof(int));
+	mgmt->ghostPages = (PageNumber *) malloc(2 * numPages * sizeof(PageNumber));
+	mgmt->heap = (int *) malloc(numPages * sizeof(int));
+	mgmt->heapPos = (int *) malloc(numPages * sizeof(int));
+	mgmt->heapSize = 0;
+	for(int i = 0; i < numPages; i++) {
+		listPushHead(mgmt, BM_LIST_LRU, i);
+		mgmt->heapPos[i] = -1;
+		if(strategy == RS_LRU_K) {
+			heapInsert(mgmt, i);
+		}
+	}
+
+	// a full pool never remembers more evicted pages than it has frames
+	mgmt->ghostFree = -1;
+	for(int g = 2 * numPages - 1; g >= numPages; g--) {
+		mgmt->nodeList[g] = -1;
+		mgmt->nodeNext[g] = mgmt->ghostFree;
+		mgmt->ghostFree = g;
+	}
+	pageMapInit(&mgmt->ghostMap, numPages);
+	mgmt->arcTarget = 0;
+	mgmt->kin = (numPages / 4 > 1) ? numPages / 4 : 1;
+	mgmt->kout = (numPages / 2 > 1) ? numPages / 2 : 1;
+	mgmt->clockMaxCount = (config->clockMaxCount > 0) ? config->clockMaxCount : 1;
+	mgmt->cpFlags = (int *) calloc(2 * numPages, sizeof(int));
+	mgmt->handHot = mgmt->handCold = mgmt->handTest = -1;
+	mgmt->cpHot = mgmt->cpGhosts = 0;
+	mgmt->coldTarget = (numPages / 4 > 1) ? numPages / 4 : 1;
+
+	// every count a page can have needs at most one bucket, plus one while a frame moves
+	mgmt->buckets = (LFU_Bucket *) malloc((numPages + 1) * sizeof(LFU_Bucket));
+	for(int b = 0; b <= numPages; b++) {
+		mgmt->buckets[b].next = (b < numPages) ? b + 1 : -1;
+	}
+	mgmt->bucketFree = 0;
+	mgmt->bucketFirst = -1;
+	mgmt->lfuAgingInterval = config->lfuAgingInterval;
+	int emptyBucket = lfuBucketFor(mgmt, -1, 0);
+	for(int i = 0; i < numPages; i++) {
+		lfuPushHead(mgmt, emptyBucket, i);
+	}
+
+	pageMapInit(&mgmt->frameMap, numPages);
+	pageMapInit(&mgmt->wbMap, numPages);
+	mgmt->ioInFlight = mgmt->writesInFlight = 0;
+	mgmt->deferWriteBack = FALSE;
+	mgmt->victimKey = NO_PAGE;
+	mgmt->spareBusy = mgmt->spareDone = FALSE;
+	mgmt->fileNext = (int *) malloc(numPages * sizeof(int));
+	mgmt->filePrev = (int *) malloc(numPages * sizeof(int));
+	mgmt->fileHead = mgmt->fileTail = NULL;
+	mgmt->fileLists = 0;
+	mgmt->pinnedFrames = 0;
+
+	pthread_mutex_init(&mgmt->lock, NULL);
+	pthread_cond_init(&mgmt->ioDone, NULL);
+	pthread_cond_init(&mgmt->bgWake, NULL);
+	pthread_cond_init(&mgmt->frameFreed, NULL);
+	mgmt->pinWaitMs = config->pinWaitTimeoutMs;
+	mgmt->syncOnFlush = config->syncOnFlush;
+	mgmt->bgDirtyHigh = config->bgDirtyHighPercent;
+	mgmt->bgDirtyLow = config->bgDirtyLowPercent;
+	mgmt->bgMaxWrites = config->bgMaxWritesPerRound;
+	mgmt->bgIntervalMs = (config->bgIntervalMs > 0) ? config->bgIntervalMs : 1;
+	mgmt->bgStop = FALSE;
+
+	bm->mgmtData = mgmt;
+	// without the thread the pool still works, dirty victims are just written by pinPage
+	mgmt->bgRunning = config->backgroundWriter
+			&& pthread_create(&mgmt->bgThread, NULL, bgWriterMain, bm) == 0;
+    return RC_OK;
+}
+
+// sets up the frames of a pool or cache reading from files, split into config->numShards
+// shards; on failure files is left to the caller
+static RC initPool(BM_BufferPool *const bm, BM_FileTable *files, void *stratData,
+        const BM_PoolConfig *config) {
+	int numPages = bm->numPages;
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) malloc(sizeof(BM_PoolMgmt));
+	mgmt->files = files;
+
+	RC rc = RC_OK;
+	int numShards = config->numShards;
+	if(numShards > numPages) {
+		numShards = numPages;
+	}
+	if(numShards <= 1) {
+		rc = initFrames(bm, mgmt, stratData, config);
+	}
+	else {
+		// the shards split the frames as evenly as possible
+		mgmt->numShards = numShards;
+		mgmt->shards = (BM_BufferPool *) malloc(numShards * sizeof(BM_BufferPool));
+		mgmt->cache = NULL;
+		mgmt->fileId = -1;
+		mgmt->manifest = NULL;
+		mgmt->warmPages = NULL;
+		mgmt->syncOnFlush = config->syncOnFlush;
+		for(int s = 0; s < numShards && rc == RC_OK; s++) {
+			BM_BufferPool *shard = &mgmt->shards[s];
+			shard->pageFile = bm->pageFile;
+			shard->numPages = numPages / numShards + (s < numPages % numShards ? 1 : 0);
+			shard->strategy = bm->strategy;
+			BM_PoolMgmt *shardMgmt = (BM_PoolMgmt *) malloc(sizeof(BM_PoolMgmt));
+			shardMgmt->files = files;
+			rc = initFrames(shard, shardMgmt, stratData, config);
+			if(rc != RC_OK) {
+				free(shardMgmt);
+				for(int t = 0; t < s; t++) {
+					freeFrames(&mgmt->shards[t]);
+					free(mgmt->shards[t].mgmtData);
+				}
+				free(mgmt->shards);
+			}
+		}
+		if(rc == RC_OK) {
+			bm->mgmtData = mgmt;
+		}
+	}
+
+	if(rc != RC_OK) {
+		free(mgmt);
+		bm->mgmtData = NULL;
+	}
+	return rc;
+}
+
+RC initBufferPoolWithConfig(BM_BufferPool *const bm, const char *const pageFileName,
+        const int numPages, ReplacementStrategy strategy,
+        void *stratData, const BM_PoolConfig *config) {
+	BM_PoolConfig defaults;
+	if(config == NULL) {
+		initPoolConfig(&defaults);
+		config = &defaults;
+	}
+
+    bm->pageFile = (char*)pageFileName;
+    bm->numPages = numPages;
+    bm->strategy = strategy;
+    bm->mgmtData = NULL;
+
+	// open the page file once, as file 0; misses and evictions of every shard reuse this handle
+	SM_FileHandle *fHandle = (SM_FileHandle *) malloc(sizeof(SM_FileHandle));
+	RC rc = openPageFileMode((char *)pageFileName, fHandle, config->ioMode);
+	if(rc != RC_OK) {
+		free(fHandle);
+		return rc;
+	}
+	BM_FileTable *files = (BM_FileTable *) malloc(sizeof(BM_FileTable));
+	fileTableInit(files, fHandle->pageSize, config->ioMode, FALSE);
+	fileTableAdd(files, fHandle, 0);
+
+	rc = initPool(bm, files, stratData, config);
+	if(rc != RC_OK) {
+		fileTableFree(files);
+	}
+	else if(config->warmupManifest != NULL) {
+		startWarmup(bm, config->warmupManifest);
+	}
+	return rc;
+}
+
+RC initBufferCache(BM_BufferPool *const cache, const int numPages, const int pageSize,
+        ReplacementStrategy strategy, void *stratData, const BM_PoolConfig *config) {
+	BM_PoolConfig defaults;
+	if(config == NULL) {
+		initPoolConfig(&defaults);
+		config = &defaults;
+	}
+	if(pageSize < SM_MIN_PAGE_SIZE || pageSize > SM_MAX_PAGE_SIZE) {
+		return RC_INVALID_PAGE_SIZE;
+	}
+
+    cache->pageFile = NULL;
+    cache->numPages = numPages;
+    cache->strategy = strategy;
+    cache->mgmtData = NULL;
+
+	// file 0 stays empty, so pinning a page of the cache itself fails
+	BM_FileTable *files = (BM_FileTable *) malloc(sizeof(BM_FileTable));
+	fileTableInit(files, pageSize, config->ioMode, TRUE);
+	fileTableAdd(files, NULL, 0);
+
+	RC rc = initPool(cache, files, stratData, config);
+	if(rc != RC_OK) {
+		fileTableFree(files);
+	}
+	return rc;
+}
+
+RC openPoolInCache(BM_BufferPool *const bm, BM_BufferPool *const cache,
+        const char *const pageFileName, const int maxFrames) {
+	if(cache->mgmtData == NULL) {
+		return RC_NON_EXISTING_BUFFERPOOL;
+	}
+	BM_FileTable *files = ((BM_PoolMgmt *) cache->mgmtData)->files;
+
+	SM_FileHandle *fHandle = (SM_FileHandle *) malloc(sizeof(SM_FileHandle));
+	RC rc = openPageFileMode((char *)pageFileName, fHandle, files->ioMode);
+	if(rc != RC_OK) {
+		free(fHandle);
+		return rc;
+	}
+	if(fHandle->pageSize > files->pageSize) {
+		closePageFile(fHandle);
+		free(fHandle);
+		return RC_INVALID_PAGE_SIZE;
+	}
+
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) malloc(sizeof(BM_PoolMgmt));
+	mgmt->files = files;
+	mgmt->cache = cache;
+	mgmt->fileId = fileTableAdd(files, fHandle, maxFrames);
+	mgmt->numShards = 0;
+	mgmt->shards = NULL;
+	mgmt->manifest = NULL;
+	mgmt->warmPages = NULL;
+	mgmt->syncOnFlush = ((BM_PoolMgmt *) cache->mgmtData)->syncOnFlush;
+
+    bm->pageFile = (char*)pageFileName;
+    bm->numPages = cache->numPages;
+    bm->strategy = cache->strategy;
+    bm->mgmtData = mgmt;
+    return RC_OK;
+}
+
+// drains the prefetches of every shard and tells whether any frame (holding a page of file
+// fileId, unless it is -1) is still pinned
+static bool poolPinned(BM_BufferPool *const bm, int fileId) {
+    BM_PoolMgmt *mgmt = (BM_PoolMgmt *)bm->mgmtData;
+    bool pinned = FALSE;
+    for(int s = 0; s < mgmt->numShards && !pinned; s++) {
+        BM_BufferPool *shard = shardAt(bm, s);
+        BM_PoolMgmt *shardMgmt = (BM_PoolMgmt *)shard->mgmtData;
+        pthread_mutex_lock(&shardMgmt->lock);
+        // frames fixed only for a prefetch or a write come free once it is done
+        while(shardMgmt->prefetchInFlight > 0 || shardMgmt->writesInFlight > 0) {
+            if(shardMgmt->prefetchInFlight > 0) {
+                reapAsync(shard, 1);
+            }
+            else {
+                pthread_cond_wait(&shardMgmt->ioDone, &shardMgmt->lock);
+            }
+        }
+        for(int i = 0; i < shard->numPages && !pinned; i++) {
+            PageFrame *frame = &shardMgmt->frames[i];
+            pinned = frame->fixCount > 0 && (fileId == -1 || BM_FILE_OF(frame->pageNum) == fileId);
+        }
+        pthread_mutex_unlock(&shardMgmt->lock);
+    }
+    return pinned;
+}
+
+RC shutdownBufferPool(BM_BufferPool *const bm) {
+
+	if(bm->mgmtData == NULL){
+		return RC_NON_EXISTING_BUFFERPOOL;
+	}
+
+    BM_PoolMgmt *mgmt = (BM_PoolMgmt *)bm->mgmtData;
+
+    // a pool in a shared cache writes its pages back and closes its file; the clean pages it
+    // leaves in the cache are never hit again, as its file id is not reused
+    if(mgmt->cache != NULL) {
+        if(poolPinned(mgmt->cache, mgmt->fileId)) {
+            return RC_SHUTDOWN_WHILE_PINNED_PAGES;
+        }
+        for(int s = 0; s < ((BM_PoolMgmt *)mgmt->cache->mgmtData)->numShards; s++) {
+            flushFrames(shardAt(mgmt->cache, s), mgmt->fileId);
+        }
+        if(mgmt->syncOnFlush) {
+            poolSync(mgmt, mgmt->fileId);
+        }
+        fileTableClose(mgmt->files, mgmt->fileId);
+        free(mgmt);
+        bm->mgmtData = NULL;
+        return RC_OK;
+    }
+
+    // the warm-up loader pins the frames it is filling, so it has to stop first
+    if(mgmt->manifest != NULL) {
+        stopWarmup(bm);
+    }
+
+    // return error if trying to shutdown while there are pinned pages in any shard
+    if(poolPinned(bm, -1)) {
+        return RC_SHUTDOWN_WHILE_PINNED_PAGES;
+    }
+
+    if(mgmt->manifest != NULL) {
+        writeManifest(bm);
+        pthread_mutex_destroy(&mgmt->warmLock);
+        free(mgmt->manifest);
+        free(mgmt->warmPages);
+    }
+
+    for(int s = 0; s < mgmt->numShards; s++) {
+        BM_BufferPool *shard = shardAt(bm, s);
+        freeFrames(shard);
+        if(shard != bm) {
+            free(shard->mgmtData);
+        }
+    }
+    if(mgmt->syncOnFlush) {
+        poolSync(mgmt, -1);
+    }
+    fileTableFree(mgmt->files);
+    free(mgmt->shards);
+    free(mgmt);
+    // prevent dangling pointer
+    bm->mgmtData = NULL;
+
+    return RC_OK;
+}
+
+
+RC forceFlushPool(BM_BufferPool *const bm) {
+
+	if(bm->mgmtData == NULL){
+		return RC_NON_EXISTING_BUFFERPOOL;
+	}
+
+    BM_PoolMgmt *mgmt = (BM_PoolMgmt *)bm->mgmtData;
+    RC rc = RC_OK;
+    if(mgmt->cache != NULL) {
+        for(int s = 0; s < ((BM_PoolMgmt *)mgmt->cache->mgmtData)->numShards; s++) {
+            RC flushRc = flushFrames(shardAt(mgmt->cache, s), mgmt->fileId);
+            rc = (rc == RC_OK) ? flushRc : rc;
+        }
+    }
+    else {
+        for(int s = 0; s < mgmt->numShards; s++) {
+            RC flushRc = flushFrames(shardAt(bm, s), -1);
+            rc = (rc == RC_OK) ? flushRc : rc;
+        }
+    }
+    if(rc == RC_OK && mgmt->syncOnFlush) {
+        rc = poolSync(mgmt, mgmt->cache != NULL ? mgmt->fileId : -1);
+    }
+    return rc;
+}
+
+RC markDirty (BM_BufferPool *const pool, BM_PageHandle *const page) {
+	BM_PoolMgmt *top = (BM_PoolMgmt *)pool->mgmtData;
+	if(top->cache != NULL) {
+		if(!BM_PAGE_IN_RANGE(page->pageNum)) {
+			return RC_READ_NON_EXISTING_PAGE;
+		}
+		BM_PageHandle keyed = *page;
+		keyed.pageNum = BM_KEY(top->fileId, page->pageNum);
+		return markDirty(top->cache, &keyed);
+	}
+	BM_BufferPool *const bm = shardFor(pool, page->pageNum);
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *)bm->mgmtData;
+
+	pthread_mutex_lock(&mgmt->lock);
+	int i = lookupFrame(mgmt, page->pageNum);
+	if(i != -1) {
+		mgmt->frames[i].isDirty = TRUE;
+	}
+	pthread_mutex_unlock(&mgmt->lock);
+	return (i == -1) ? RC_READ_NON_EXISTING_PAGE : RC_OK;
+}
+
+RC unpinPage (BM_BufferPool *const pool, BM_PageHandle *const page) {
+	BM_PoolMgmt *top = (BM_PoolMgmt *)pool->mgmtData;
+	if(top->cache != NULL) {
+		if(!BM_PAGE_IN_RANGE(page->pageNum)) {
+			return RC_READ_NON_EXISTING_PAGE;
+		}
+		BM_PageHandle keyed = *page;
+		keyed.pageNum = BM_KEY(top->fileId, page->pageNum);
+		RC rc = unpinPage(top->cache, &keyed);
+		page->latchMode = keyed.latchMode;
+		return rc;
+	}
+	BM_BufferPool *const bm = shardFor(pool, page->pageNum);
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *)bm->mgmtData;
+
+	pthread_mutex_lock(&mgmt->lock);
+	int i = lookupFrame(mgmt, page->pageNum);
+	if(i != -1 && page->latchMode != BM_LATCH_NONE) {
+		pthread_rwlock_unlock(mgmt->frames[i].latch);
+		page->latchMode = BM_LATCH_NONE;
+	}
+	if(i != -1 && --mgmt->frames[i].fixCount == 0) {
+		mgmt->pinnedFrames--;
+		if(bm->strategy == RS_LRU_K) {
+			heapInsert(mgmt, i);
+		}
+		pthread_cond_broadcast(&mgmt->frameFreed);
+	}
+	pthread_mutex_unlock(&mgmt->lock);
+	return (i == -1) ? RC_READ_NON_EXISTING_PAGE : RC_OK;
+}
+
+RC forcePage (BM_BufferPool *const pool, BM_PageHandle *const page) {
+	BM_PoolMgmt *top = (BM_PoolMgmt *)pool->mgmtData;
+	if(top->cache != NULL) {
+		if(!BM_PAGE_IN_RANGE(page->pageNum)) {
+			return RC_READ_NON_EXISTING_PAGE;
+		}
+		BM_PageHandle keyed = *page;
+		keyed.pageNum = BM_KEY(top->fileId, page->pageNum);
+		return forcePage(top->cache, &keyed);
+	}
+	BM_BufferPool *const bm = shardFor(pool, page->pageNum);
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *)bm->mgmtData;
+
+	pthread_mutex_lock(&mgmt->lock);
+	int i = waitForPage(bm, page->pageNum);
+	RC rc = RC_READ_NON_EXISTING_PAGE;
+	if(i != -1) {
+		// the caller's own page, written as it stands, like any page it changes while pinned
+		BM_DirtyPage dirty = { page->pageNum, i };
+		int n = 1;
+		rc = writeDirtyPages(bm, &dirty, &n, FALSE);
+	}
+	pthread_mutex_unlock(&mgmt->lock);
+	return rc;
+}
+
+static RC pinPageLocked (BM_BufferPool *const bm, BM_PageHandle *const page,
+        const PageNumber pageNum);
+static RC pinPageWaiting (BM_BufferPool *const bm, BM_PageHandle *const page,
+        const PageNumber pageNum);
+static RC pinPageCached (BM_BufferPool *const pool, BM_PageHandle *const page,
+        const PageNumber pageNum);
+
+// lets the pool's replacement strategy pick a frame for page, write the old page back and place it
+static void replacePage(BM_BufferPool *const bm, PageFrame *page) {
+	((BM_PoolMgmt *) bm->mgmtData)->victimSearches++;
+	switch(bm->strategy) {
+		case RS_FIFO: // Using FIFO algorithm
+			FIFO(bm, page);
+			break;
+
+		case RS_LRU: // Using LRU algorithm
+			LRU(bm, page);
+			break;
+
+		case RS_CLOCK: // Using CLOCK algorithm
+			CLOCK(bm, page);
+			break;
+
+		case RS_LFU: // Using LFU algorithm
+			LFU(bm, page);
+			break;
+
+		case RS_LRU_K:	// Using LRU-K algorithm
+			LRU_K(bm, page);
+			break;
+
+		case RS_ARC:	// Using ARC algorithm
+			ARC(bm, page);
+			break;
+
+		case RS_2Q:	// Using 2Q algorithm
+			TWO_Q(bm, page);
+			break;
+
+		case RS_CLOCK_PRO:	// Using CLOCK-Pro algorithm
+			CLOCK_PRO(bm, page);
+			break;
+
+		default:
+			printf("\nNone\n");
+			break;
+	}
+}
+
+// puts page into frame i, which a scan ring is recycling, with the bookkeeping the strategy
+// does for a page it placed itself; ARC and 2Q remember no ghost for the scan page that leaves
+static void recycleFrame(BM_BufferPool *const bm, int i, PageFrame *page) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+
+	// if the found page is dirty, write it back
+	if(pf[i].isDirty == TRUE) {
+		writeBackVictim(bm, i);
+	}
+	if(bm->strategy == RS_LRU_K) {
+		heapRemove(mgmt, i);
+	}
+	placePage(mgmt, i, page);
+
+	switch(bm->strategy) {
+		case RS_LRU:
+			listMoveHead(mgmt, BM_LIST_LRU, i);
+			break;
+		case RS_ARC:
+			listMoveHead(mgmt, BM_LIST_T1, i);
+			break;
+		case RS_2Q:
+			listMoveHead(mgmt, BM_LIST_A1IN, i);
+			break;
+		case RS_CLOCK:
+			pf[i].hitNum = 1;
+			break;
+		case RS_CLOCK_PRO:
+			if(mgmt->cpFlags[i] & CP_HOT) {
+				mgmt->cpHot--;
+			}
+			mgmt->cpFlags[i] = 0;
+			pf[i].hitNum = 0;
+			break;
+		case RS_LFU:
+			lfuSetCount(mgmt, i, 1);
+			break;
+		default:
+			break;
+	}
+}
+
+// a file of a shared cache that already holds its quota of frames replaces one of its own pages:
+// the least recently used unpinned one in this shard, or -1 if the file is within its quota
+// (or has no such page here, in which case the strategy picks as usual)
+static int quotaVictim(BM_BufferPool *const bm, PageNumber key) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	BM_FileTable *files = mgmt->files;
+	int f = BM_FILE_OF(key);
+
+	pthread_mutex_lock(&files->lock);
+	bool full = files->quota[f] > 0 && files->frames[f] >= files->quota[f];
+	pthread_mutex_unlock(&files->lock);
+	if(!full) {
+		return -1;
+	}
+
+	// the file's frames from the least recently used on; pinned ones and those being read stay
+	for(int i = (f < mgmt->fileLists) ? mgmt->fileTail[f] : -1; i != -1; i = mgmt->filePrev[i]) {
+		if(mgmt->frames[i].fixCount == 0 && !mgmt->frames[i].ioPending) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// the frame the ring can reuse for its next page, or -1: the slot's frame has to still hold the
+// page the ring put there (a resize may have moved it or dropped the frame) and be neither
+// pinned nor being read
+static int ringVictim(BM_BufferPool *const bm, BM_ScanRing *ring, int s) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	int slot = s * ring->size + ring->next[s];
+	int f = ring->frames[slot];
+	if(f == -1 || f >= bm->numPages || mgmt->frames[f].pageNum != ring->pages[slot]
+			|| mgmt->frames[f].fixCount > 0 || mgmt->frames[f].ioPending) {
+		return -1;
+	}
+	return f;
+}
+
+static void ringAdvance(BM_ScanRing *ring, int s, int frame, PageNumber pageNum) {
+	int slot = s * ring->size + ring->next[s];
+	ring->frames[slot] = frame;
+	ring->pages[slot] = pageNum;
+	ring->next[s] = (ring->next[s] + 1) % ring->size;
+}
+
+RC initScanRing (BM_BufferPool *const pool, BM_ScanRing **ring, int numFrames) {
+	if(pool->mgmtData == NULL){
+		return RC_NON_EXISTING_BUFFERPOOL;
+	}
+
+	int f;
+	BM_BufferPool *const bm = framesOf(pool, &f);
+
+	// a ring never spans more than a quarter of the pool (as large as it is now: a resize may
+	// change it at any time)
+	int numPages = lockShards(bm);
+	unlockShards(bm);
+	if(numFrames > numPages / 4) {
+		numFrames = numPages / 4;
+	}
+	// a shard's pages can only go into that shard's frames, so the ring is split between them
+	int numRings = ((BM_PoolMgmt *) bm->mgmtData)->numShards;
+	int size = numFrames / numRings;
+	if(size < 1) {
+		size = 1;
+	}
+	BM_ScanRing *r = (BM_ScanRing *) malloc(sizeof(BM_ScanRing));
+	r->numRings = numRings;
+	r->size = size;
+	r->next = (int *) calloc(numRings, sizeof(int));
+	r->frames = (int *) malloc(numRings * size * sizeof(int));
+	r->pages = (PageNumber *) malloc(numRings * size * sizeof(PageNumber));
+	for(int k = 0; k < numRings * size; k++) {
+		r->frames[k] = -1;
+		r->pages[k] = NO_PAGE;
+	}
+	*ring = r;
+	return RC_OK;
+}
+
+RC freeScanRing (BM_ScanRing *ring) {
+	if(ring != NULL) {
+		free(ring->next);
+		free(ring->frames);
+		free(ring->pages);
+		free(ring);
+	}
+	return RC_OK;
+}
+
+RC pinPageWithRing (BM_BufferPool *const pool, BM_PageHandle *const page,
+        const PageNumber pageNum, BM_ScanRing *ring) {
+
+	if(pool->mgmtData == NULL){
+		return RC_NON_EXISTING_BUFFERPOOL;
+	}
+
+	BM_PoolMgmt *top = (BM_PoolMgmt *) pool->mgmtData;
+	if(top->cache != NULL) {
+		if(!BM_PAGE_IN_RANGE(pageNum)) {
+			return RC_READ_NON_EXISTING_PAGE;
+		}
+		RC rc = pinPageWithRing(top->cache, page, BM_KEY(top->fileId, pageNum), ring);
+		page->pageNum = pageNum;
+		return rc;
+	}
+	// a cache itself is called with keys, which use the bits above a page number
+	if(!top->files->shared && pageNum > BM_MAX_PAGE) {
+		return RC_READ_NON_EXISTING_PAGE;
+	}
+
+	int s = shardIndex(pool, pageNum);
+	BM_BufferPool *const bm = shardAt(pool, s);
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	RC rc;
+	pthread_mutex_lock(&mgmt->lock);
+
+	// hits go through the pool as usual, only misses take a ring frame; a page being loaded or
+	// written back is waited for first
+	if(ring == NULL || pageNum < 0 || waitForPage(bm, pageNum) != -1) {
+		rc = pinPageWaiting(bm, page, pageNum);
+	}
+	else {
+		int i = ringVictim(bm, ring, s);
+		if(i != -1) {
+			PageFrame newPage;
+			newPage.pageNum = pageNum;
+			newPage.isDirty = 0;
+			newPage.fixCount = 1;
+			newPage.hitNum = 0;
+			mgmt->globalHitCount++;
+			mgmt->misses++;
+			mgmt->deferWriteBack = TRUE;
+			mgmt->victimKey = NO_PAGE;
+			recycleFrame(bm, i, &newPage);
+			mgmt->deferWriteBack = FALSE;
+			rc = loadFrame(bm, i, pageNum, mgmt->victimKey, TRUE);
+			mgmt->readCnt++;
+
+			if(rc != RC_OK) {
+				// the ring slot keeps its old frame; the emptied one goes back to the pool
+				failPin(bm, i);
+				i = -1;
+			}
+			else {
+				page->pageNum = pageNum;
+				page->data = mgmt->frames[i].data;
+				page->latchMode = BM_LATCH_NONE;
+			}
+		}
+		else {
+			// the slot is empty or its frame went back to the pool: let the strategy pick one
+			rc = pinPageWaiting(bm, page, pageNum);
+			i = (rc == RC_OK) ? lookupFrame(mgmt, pageNum) : -1;
+		}
+		if(i != -1) {
+			ringAdvance(ring, s, i, pageNum);
+		}
+	}
+
+	pthread_mutex_unlock(&mgmt->lock);
+	return rc;
+}
+
+// starts reading pageNum into a frame the replacement strategy (or the scan ring, if given)
+// picks, without waiting for it; the caller submits the batch. A full prefetch window drops the hint
+static RC startPrefetch(BM_BufferPool *const bm, const PageNumber pageNum, BM_ScanRing *ring, int s) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+
+	if(pageNum < 0 || (!mgmt->files->shared && pageNum > BM_MAX_PAGE) || !poolHasPage(mgmt, pageNum)) {
+		return RC_READ_NON_EXISTING_PAGE;
+	}
+	if(lookupFrame(mgmt, pageNum) != -1) {
+		return RC_OK;
+	}
+	if(mgmt->prefetchInFlight > 0) {
+		reapAsync(bm, 0);
+	}
+	if(mgmt->prefetchInFlight >= mgmt->prefetchLimit) {
+		return RC_OK;
+	}
+	if(mgmt->pinnedFrames == bm->numPages) {
+		return RC_REPLACE_WHILE_PINNED_PAGES;
+	}
+	if(mgmt->aio == NULL && initAsyncIO(&mgmt->aio, BM_ASYNC_QUEUE_DEPTH, SM_AIO_AUTO) != RC_OK) {
+		mgmt->aio = NULL;
+		return RC_ASYNC_IO_UNAVAILABLE;
+	}
+
+	// the prefetch holds a fix on the frame until its read is reaped
+	PageFrame newPage;
+	newPage.pageNum = pageNum;
+	newPage.isDirty = 0;
+	newPage.fixCount = 1;
+	newPage.hitNum = 0;
+	mgmt->deferWriteBack = TRUE;
+	mgmt->victimKey = NO_PAGE;
+	int i = (ring != NULL) ? ringVictim(bm, ring, s) : -1;
+	if(i == -1) {
+		i = quotaVictim(bm, pageNum);
+	}
+	if(i != -1) {
+		recycleFrame(bm, i, &newPage);
+	}
+	else {
+		replacePage(bm, &newPage);
+		i = lookupFrame(mgmt, pageNum);
+	}
+	mgmt->deferWriteBack = FALSE;
+	if(i == -1) {
+		return RC_REPLACE_WHILE_PINNED_PAGES;
 	}
-
-	for(i=0; i < bm->numPages; i++) {
-		if(pf[front].fixCount == 0) {
-			if(pf[front].isDirty == TRUE) {
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				writeBlock(pf[front].pageNum, &fh, pf[front].data);
-				closePageFile(&fh);
-				writeCnt++;
-			}
-			pf[front].data = page->data;
-			pf[front].pageNum = page->pageNum;
-			pf[front].isDirty = page->isDirty;
-			pf[front].fixCount = page->fixCount;
-			front++;
-			front = (front % bm->numPages == 0) ? 0 : front;
-			break;
-		}
-		else {
-			front++;
-			front = (front % bm->numPages == 0) ? 0 : front;
-		}
+	if(ring != NULL) {
+		ringAdvance(ring, s, i, pageNum);
 	}
+	mgmt->readCnt++;
+	// a dirty victim is written back with the latch released before the read is queued
+	if(mgmt->victimKey != NO_PAGE) {
+		loadFrame(bm, i, pageNum, mgmt->victimKey, FALSE);
+		pf = mgmt->frames;
+	}
+
+	SM_AsyncRequest *req = &mgmt->prefetchReqs[i];
+	poolAsyncRead(mgmt, pageNum, pf[i].data, req);
+	req->userData = &pf[i];
+	pf[i].ioPending = TRUE;
+	pf[i].prefetched = TRUE;
+	mgmt->prefetchInFlight++;
+	queueAsyncIO(mgmt->aio, req);
+	return RC_OK;
 }
 
-void CLOCK(BM_BufferPool *const bm, PageFrame *page)
-{
-	PageFrame *pf = (PageFrame *) bm->mgmtData;
-	while(1)
-	{
-		clock %= bm->numPages;
+RC prefetchPage (BM_BufferPool *const pool, const PageNumber pageNum) {
+	if(pool->mgmtData == NULL){
+		return RC_NON_EXISTING_BUFFERPOOL;
+	}
 
-		if(pf[clock].hitNum == 0 && pf[clock].fixCount == 0) {
-			if(pf[clock].isDirty == TRUE) {
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				writeBlock(pf[clock].pageNum, &fh, pf[clock].data);
-				closePageFile(&fh);
-				writeCnt++;
-			}
+	BM_PoolMgmt *top = (BM_PoolMgmt *) pool->mgmtData;
+	if(top->cache != NULL) {
+		return !BM_PAGE_IN_RANGE(pageNum) ? RC_READ_NON_EXISTING_PAGE : prefetchPage(top->cache, BM_KEY(top->fileId, pageNum));
+	}
 
-			pf[clock].data = page->data;
-			pf[clock].pageNum = page->pageNum;
-			pf[clock].isDirty = page->isDirty;
-			pf[clock].fixCount = page->fixCount;
-			pf[clock].hitNum = page->hitNum;
-			clock++;
-			break;
-		}
-		else {
-			pf[clock++].hitNum = 0;
-		}
+	BM_BufferPool *const bm = shardFor(pool, pageNum);
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	pthread_mutex_lock(&mgmt->lock);
+	RC rc = startPrefetch(bm, pageNum, NULL, 0);
+	if(mgmt->aio != NULL) {
+		submitAsyncIO(mgmt->aio);
 	}
+	pthread_mutex_unlock(&mgmt->lock);
+	return rc;
 }
 
-void LRU_K(BM_BufferPool *const bm, PageFrame *page) {
+RC prefetchRange (BM_BufferPool *const bm, const PageNumber firstPage, const int count) {
+	return prefetchRangeWithRing(bm, firstPage, count, NULL);
+}
 
-	PageFrame *pf = (PageFrame *) bm->mgmtData;
+RC prefetchRangeWithRing (BM_BufferPool *const pool, const PageNumber firstPage, const int count,
+        BM_ScanRing *ring) {
+	if(pool->mgmtData == NULL){
+		return RC_NON_EXISTING_BUFFERPOOL;
+	}
 
-	// go through all the pages to check if there's empty spot
-	for(int i = 0; i < bm->numPages; i++) {
-		if(pf[i].pageNum == NO_PAGE) {
-			pf[i].data = page->data;
-			pf[i].pageNum = page->pageNum;
-			pf[i].isDirty = page->isDirty;
-			pf[i].fixCount = page->fixCount;
-			pf[i].LRU_array[0] = globalHitCount;
-			return;
+	BM_PoolMgmt *top = (BM_PoolMgmt *) pool->mgmtData;
+	if(top->cache != NULL) {
+		if(!BM_PAGE_IN_RANGE(firstPage)) {
+			return RC_READ_NON_EXISTING_PAGE;
 		}
+		// keys past the file's last possible page belong to the next file
+		int n = (count > BM_MAX_PAGE - firstPage) ? (int)(BM_MAX_PAGE - firstPage + 1) : count;
+		return prefetchRangeWithRing(top->cache, BM_KEY(top->fileId, firstPage), n, ring);
 	}
 
-	// go through all the pages and find the page with lowest Kth accessed time (least recently accessed) that is not pinned
-	int LRU_index = -1, LRU_hitNum = globalHitCount;
-	for(int i = 0; i < bm->numPages; i++) {
-		if(pf[i].fixCount == 0 && pf[i].LRU_array[K-1] < LRU_hitNum) {
-			LRU_index = i;
-			LRU_hitNum = pf[i].LRU_array[K-1];
-		}
+	RC rc = RC_OK;
+	// a ring has to keep the page being scanned as well as the prefetched ones
+	int n = count;
+	if(ring != NULL && n > (ring->size - 1) * ring->numRings) {
+		n = (ring->size - 1) * ring->numRings;
 	}
 
-	// if we find suitable page that can be evicted
-	if(LRU_index != -1) {
-		// if the found page is dirty, write it back
-		if(pf[LRU_index].isDirty == TRUE) {
-			SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			writeBlock(pf[LRU_index].pageNum, &fh, pf[LRU_index].data);
-			closePageFile(&fh);
-			writeCnt++;
+	// one submission per run of pages in the same shard (the whole range when unsharded),
+	// the range ends quietly at the end of the file
+	BM_BufferPool *bm = NULL;
+	BM_PoolMgmt *mgmt = NULL;
+	for(int k = 0; k < n && rc == RC_OK; k++) {
+		int s = shardIndex(pool, firstPage + k);
+		if(bm != shardAt(pool, s)) {
+			if(bm != NULL) {
+				if(mgmt->aio != NULL) {
+					submitAsyncIO(mgmt->aio);
+				}
+				pthread_mutex_unlock(&mgmt->lock);
+			}
+			bm = shardAt(pool, s);
+			mgmt = (BM_PoolMgmt *) bm->mgmtData;
+			pthread_mutex_lock(&mgmt->lock);
 		}
-		pf[LRU_index].data = page->data;
-		pf[LRU_index].pageNum = page->pageNum;
-		pf[LRU_index].isDirty = page->isDirty;
-		pf[LRU_index].fixCount = page->fixCount;
-		for(int i = 1; i < K; i++) {
-			pf[LRU_index].LRU_array[i] = 0;
+		rc = startPrefetch(bm, firstPage + k, ring, s);
+		if(rc == RC_READ_NON_EXISTING_PAGE && k > 0) {
+			rc = RC_OK;
+			break;
+		}
+	}
+	if(bm != NULL) {
+		if(mgmt->aio != NULL) {
+			submitAsyncIO(mgmt->aio);
 		}
-		pf[LRU_index].LRU_array[0] = globalHitCount;
+		pthread_mutex_unlock(&mgmt->lock);
 	}
+	return rc;
 }
 
-void LFU(BM_BufferPool *const bm, PageFrame *page) {
-
-	PageFrame *pf = (PageFrame *) bm->mgmtData;
+RC pinPage (BM_BufferPool *const pool, BM_PageHandle *const page,
+        const PageNumber pageNum) {
 
-	// go through all the pages to check if there's empty spot
-	for(int i = 0; i < bm->numPages; i++) {
-		if(pf[i].pageNum == NO_PAGE) {
-			pf[i].data = page->data;
-			pf[i].pageNum = page->pageNum;
-			pf[i].isDirty = page->isDirty;
-			pf[i].fixCount = page->fixCount;
-			pf[i].hitNum = 1;
-			// to break ties
-			pf[i].LRU_array[0] = globalHitCount;
-			return;
-		}
+	if(pool->mgmtData == NULL){
+		return RC_NON_EXISTING_BUFFERPOOL;
 	}
 
-	// go through all the pages and find the page with lowest hitNum (least frequently used) that is not pinned
-	// in case of a tie, choose the one which was least recently accessed
-	int LFU_index = -1, LFU_hitNum = INT_MAX;
-	for(int i = 0; i < bm->numPages; i++) {
-		if(pf[i].fixCount == 0) {
-			if(pf[i].hitNum < LFU_hitNum || (pf[i].hitNum == LFU_hitNum && pf[i].LRU_array[0] < pf[LFU_index].LRU_array[0])) {
-				LFU_index = i;
-				LFU_hitNum = pf[i].hitNum;
-			}
-		}
+	BM_PoolMgmt *top = (BM_PoolMgmt *) pool->mgmtData;
+	if(pageNum > BM_MAX_PAGE) {
+		return RC_READ_NON_EXISTING_PAGE;
 	}
-
-	// if we find suitable page that can be evicted
-	if(LFU_index != -1) {
-
-		// if the found page is dirty, write it back
-		if(pf[LFU_index].isDirty == TRUE) {
-			SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			writeBlock(pf[LFU_index].pageNum, &fh, pf[LFU_index].data);
-			closePageFile(&fh);
-			writeCnt++;
+	if(top->cache != NULL) {
+		if(pageNum < 0) {
+			return RC_READ_NON_EXISTING_PAGE;
 		}
-
-		pf[LFU_index].data = page->data;
-		pf[LFU_index].pageNum = page->pageNum;
-		pf[LFU_index].isDirty = page->isDirty;
-		pf[LFU_index].fixCount = page->fixCount;
-		pf[LFU_index].hitNum = 1;
-		pf[LFU_index].LRU_array[0] = globalHitCount;
+		RC rc = pinPageCached(top->cache, page, BM_KEY(top->fileId, pageNum));
+		page->pageNum = pageNum;
+		return rc;
+	}
+	// a cache's frames are only used through the pools opened in it
+	if(top->files->shared) {
+		return RC_FILE_HANDLE_NOT_INIT;
 	}
+	return pinPageCached(pool, page, pageNum);
 }
 
-RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
-        const int numPages, ReplacementStrategy strategy,
-        void *stratData) {
-	front = 0;
-	rear = -1;
-	clock = 0;
-	globalHitCount = 0;
-	writeCnt = readCnt = 0;
+// pins the page of pool (or, with pageNum a key, of a cache) in the shard it belongs to
+static RC pinPageCached (BM_BufferPool *const pool, BM_PageHandle *const page,
+        const PageNumber pageNum) {
+	BM_BufferPool *const bm = shardFor(pool, pageNum);
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	pthread_mutex_lock(&mgmt->lock);
+	RC rc = pinPageWaiting(bm, page, pageNum);
+	pthread_mutex_unlock(&mgmt->lock);
+	return rc;
+}
 
-    bm->pageFile = (char*)pageFileName;
-    bm->numPages = numPages;
-    bm->strategy = strategy;
+// pins the page like pinPage, then takes its frame's content latch in the given mode; the
+// latch is released by unpinPage. The pool latch is not held while waiting for the content latch
+static RC pinPageLatched (BM_BufferPool *const pool, BM_PageHandle *const page,
+        const PageNumber pageNum, BM_LatchMode mode) {
+	RC rc = pinPage(pool, page, pageNum);
+	if(rc != RC_OK) {
+		return rc;
+	}
 
-	if(stratData == NULL) {
-		K = 1;
+	// the pin keeps the page resident, so its latch stays valid without the pool latch
+	int f;
+	BM_BufferPool *frames = framesOf(pool, &f);
+	PageNumber key = (f == -1) ? pageNum : BM_KEY(f, pageNum);
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shardFor(frames, key)->mgmtData;
+	pthread_mutex_lock(&mgmt->lock);
+	pthread_rwlock_t *latch = mgmt->frames[lookupFrame(mgmt, key)].latch;
+	pthread_mutex_unlock(&mgmt->lock);
+	if(mode == BM_LATCH_SHARED) {
+		pthread_rwlock_rdlock(latch);
 	}
 	else {
-		K = *((int *)(stratData));
+		pthread_rwlock_wrlock(latch);
 	}
+	page->latchMode = mode;
+	return RC_OK;
+}
 
-    // allocate memory and zero initalize everything
-    PageFrame *pf = malloc(numPages * sizeof(PageFrame));
+RC pinPageShared (BM_BufferPool *const bm, BM_PageHandle *const page,
+        const PageNumber pageNum) {
+	return pinPageLatched(bm, page, pageNum, BM_LATCH_SHARED);
+}
 
-	for(int i = 0; i < numPages; i++) {
-		pf[i].data = NULL;
-		pf[i].pageNum = NO_PAGE;
-		pf[i].isDirty = 0;
-		pf[i].fixCount = 0;
-		pf[i].LRU_array = (int*)malloc(K * sizeof(int));
+RC pinPageExclusive (BM_BufferPool *const bm, BM_PageHandle *const page,
+        const PageNumber pageNum) {
+	return pinPageLatched(bm, page, pageNum, BM_LATCH_EXCLUSIVE);
+}
+
+// pinPageLocked, but when every frame is pinned wait (pinWaitMs) for an unpin and retry
+static RC pinPageWaiting (BM_BufferPool *const bm, BM_PageHandle *const page,
+        const PageNumber pageNum) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	RC rc = pinPageLocked(bm, page, pageNum);
+	if(rc == RC_REPLACE_WHILE_PINNED_PAGES && mgmt->pinWaitMs != 0) {
+		mgmt->pinWaits++;
+		struct timespec deadline;
+		deadlineAfter(&deadline, mgmt->pinWaitMs);
+		while(rc == RC_REPLACE_WHILE_PINNED_PAGES) {
+			if(mgmt->pinWaitMs < 0) {
+				pthread_cond_wait(&mgmt->frameFreed, &mgmt->lock);
+			}
+			else if(pthread_cond_timedwait(&mgmt->frameFreed, &mgmt->lock, &deadline) != 0) {
+				// timed out, one last try in case a frame came free just now
+				rc = pinPageLocked(bm, page, pageNum);
+				break;
+			}
+			rc = pinPageLocked(bm, page, pageNum);
+		}
 	}
-	bm->mgmtData = pf;
-    return RC_OK;
+	if(rc == RC_REPLACE_WHILE_PINNED_PAGES) {
+		mgmt->failedPins++;
+	}
+	return rc;
 }
 
-RC shutdownBufferPool(BM_BufferPool *const bm) {
+static RC pinPageLocked (BM_BufferPool *const bm, BM_PageHandle *const page,
+        const PageNumber pageNum) {
 
 	if(bm->mgmtData == NULL){
 		return RC_NON_EXISTING_BUFFERPOOL;
 	}
 
-    PageFrame *pf = (PageFrame*)bm->mgmtData;
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
 
-    // return error if trying to shutdown while there are pinned pages
-    for(int i = 0; i < bm->numPages; i++) {
-        if(pf[i].fixCount != 0) {
-            return RC_SHUTDOWN_WHILE_PINNED_PAGES;
-        }
-    }
+	mgmt->globalHitCount++;
+	if(bm->strategy == RS_LFU && mgmt->lfuAgingInterval > 0 && mgmt->globalHitCount % mgmt->lfuAgingInterval == 0) {
+		lfuAge(mgmt);
+	}
+	if(pageNum<0){
+		return RC_READ_NON_EXISTING_PAGE;
+	}
+	// check if the page already exists, if so - increment its fixCount and update the hitNum;
+	// a prefetch whose read failed (or a miss that failed to load it) leaves no frame, making this a miss
+	int i = waitForPage(bm, pageNum);
+	// frames held only by a prefetch or a write come free once the I/O is done; meanwhile
+	// another thread may load the page
+	while(i == -1 && mgmt->pinnedFrames == bm->numPages
+			&& (mgmt->prefetchInFlight > 0 || mgmt->writesInFlight > 0)) {
+		if(mgmt->prefetchInFlight > 0) {
+			reapAsync(bm, 1);
+		}
+		else {
+			pthread_cond_wait(&mgmt->ioDone, &mgmt->lock);
+		}
+		i = waitForPage(bm, pageNum);
+	}
+	pf = mgmt->frames;
+	if(i != -1) {
+		mgmt->hits++;
+		if(pf[i].fixCount++ == 0) {
+			mgmt->pinnedFrames++;
+			if(bm->strategy == RS_LRU_K) {
+				heapRemove(mgmt, i);
+			}
+		}
 
-    // write back dirty pages before shutting down
-    forceFlushPool(bm);
+		// placing a prefetched page already counted as its first reference
+		bool firstUse = pf[i].prefetched;
+		pf[i].prefetched = FALSE;
+		if(!firstUse) {
+			switch(bm->strategy) {
+				case RS_LRU:
+					listMoveHead(mgmt, BM_LIST_LRU, i);
+					break;
+				case RS_ARC:
+					listMoveHead(mgmt, BM_LIST_T2, i);
+					break;
+				case RS_2Q:
+					if(mgmt->nodeList[i] == BM_LIST_AM) {
+						listMoveHead(mgmt, BM_LIST_AM, i);
+					}
+					break;
+				case RS_CLOCK:
+					if(pf[i].hitNum < mgmt->clockMaxCount) {
+						pf[i].hitNum++;
+					}
+					break;
+				case RS_CLOCK_PRO:
+					pf[i].hitNum = 1;
+					break;
+				case RS_LFU:
+					lfuSetCount(mgmt, i, pf[i].hitNum + 1);
+					break;
+				default:
+					break;
+			}
+			recordAccess(mgmt, &pf[i]);
+			fileListTouch(mgmt, i);
+		}
 
-    // free allocated pages
-    free(pf);
-    // prevent dangling pointer
-    bm->mgmtData = NULL;
+		page->pageNum = pageNum;
+		page->data = pf[i].data;
+		page->latchMode = BM_LATCH_NONE;
 
-    return RC_OK;
-}
+		return RC_OK;
+	}
 
-RC forceFlushPool(BM_BufferPool *const bm) {
+	if(mgmt->pinnedFrames == bm->numPages){
+		return RC_REPLACE_WHILE_PINNED_PAGES;
+	}
 
-	if(bm->mgmtData == NULL){
-		return RC_NON_EXISTING_BUFFERPOOL;
+	// else we need to read the pageFile
+	mgmt->misses++;
+	PageFrame newPage;
+	newPage.pageNum = pageNum;
+	newPage.isDirty = 0;
+	newPage.fixCount = 1;
+	newPage.hitNum = 0;
+	mgmt->readCnt++;
+
+	// the strategy picks and reassigns a victim frame; a dirty victim is written back by loadFrame
+	mgmt->deferWriteBack = TRUE;
+	mgmt->victimKey = NO_PAGE;
+	int victim = quotaVictim(bm, pageNum);
+	if(victim != -1) {
+		recycleFrame(bm, victim, &newPage);
+	}
+	else {
+		replacePage(bm, &newPage);
 	}
+	mgmt->deferWriteBack = FALSE;
 
-    PageFrame *pf = (PageFrame*)bm->mgmtData;
+	i = lookupFrame(mgmt, pageNum);
+	if(i == -1) {
+		return RC_REPLACE_WHILE_PINNED_PAGES;
+	}
+	RC rc = loadFrame(bm, i, pageNum, mgmt->victimKey, TRUE);
+	if(rc != RC_OK) {
+		failPin(bm, i);
+		return rc;
+	}
 
-    for(int i = 0; i < bm->numPages; i++) {
-		if(pf[i].fixCount == 0 && pf[i].isDirty == TRUE)
-		{
-		   	SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			writeBlock(pf[i].pageNum, &fh, pf[i].data);
-			closePageFile(&fh);
-			pf[i].isDirty = FALSE;
-			writeCnt++;
-        }
-    }
-    return RC_OK;
+	page->pageNum = pageNum;
+	page->data = mgmt->frames[i].data;
+	page->latchMode = BM_LATCH_NONE;
+	return RC_OK;
 }
 
-RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page) {
-	PageFrame *pf = (PageFrame *)bm->mgmtData;
 
-	for(int i = 0; i < bm->numPages; i++) {
-		if(pf[i].pageNum == page->pageNum) {
-			pf[i].isDirty = TRUE;
-			return RC_OK;
-		}
+// placeholder page numbers (below NO_PAGE) that evictFrames parks in the frames a shrink frees
+#define BM_PLACEHOLDER(k) (NO_PAGE - 1 - (k))
+
+// frees count frames of one shard for a shrink: the strategy places a pinned placeholder as if it
+// had missed, so it picks (and writes back) each victim exactly as for a real miss. The caller has
+// drained the prefetches and made sure at least count frames are unpinned
+static void evictFrames(BM_BufferPool *const bm, int count) {
+	for(int k = 0; k < count; k++) {
+		PageFrame placeholder;
+		placeholder.pageNum = BM_PLACEHOLDER(k);
+		placeholder.isDirty = FALSE;
+		placeholder.fixCount = 1;
+		placeholder.hitNum = 0;
+		replacePage(bm, &placeholder);
 	}
-	return RC_READ_NON_EXISTING_PAGE;
 }
 
-RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page) {
-	PageFrame *pf = (PageFrame *)bm->mgmtData;
-
-	for(int i = 0; i < bm->numPages; i++) {
-		if(pf[i].pageNum == page->pageNum) {
-			pf[i].fixCount--;
-			return RC_OK;
+// the node a CLOCK-Pro hand points at after a rebuild: the first kept node from where it pointed
+static int remapHand(BM_PoolMgmt *mgmt, int *remap, int hand) {
+	int node = hand;
+	do {
+		if(remap[node] != -1) {
+			return remap[node];
 		}
-	}
-	return RC_READ_NON_EXISTING_PAGE;
+		node = mgmt->nodeNext[node];
+	} while(node != hand);
+	return -1;
 }
 
-RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page) {
-	PageFrame *pf = (PageFrame *)bm->mgmtData;
-
-	for(int i = 0; i < bm->numPages; i++)
-	{
-		if(pf[i].pageNum == page->pageNum)
-		{
-			SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			writeBlock(pf[i].pageNum, &fh, pf[i].data);
-			closePageFile(&fh);
-			pf[i].isDirty = FALSE;
+// copies the replacement lists, ghosts and CLOCK-Pro ring of mgmt (oldNumPages frames) into nw,
+// which has room for n frames and as many ghosts. remap maps every old frame to its new index
+// (or -1) and gets the old ghosts' new nodes; the oldest ghosts are forgotten if they do not fit.
+// Frames kept..n-1 are new and go to the victim end of the list every frame starts in
+static void rebuildNodes(BM_PoolMgmt *mgmt, BM_PoolMgmt *nw, int *remap, int oldNumPages, int n, int kept) {
+	for(int l = 0; l < BM_NUM_LISTS; l++) {
+		nw->lists[l].head = nw->lists[l].tail = -1;
+		nw->lists[l].size = 0;
+	}
+	for(int node = 0; node < 2 * n; node++) {
+		nw->nodeList[node] = -1;
+	}
+	nw->ghostFree = -1;
+	for(int g = 2 * n - 1; g >= n; g--) {
+		nw->nodeNext[g] = nw->ghostFree;
+		nw->ghostFree = g;
+	}
+	pageMapInit(&nw->ghostMap, n);
+	int excess = oldNumPages - n;
+	for(int g = mgmt->ghostFree; g != -1; g = mgmt->nodeNext[g]) {
+		excess--;
+	}
 
-			writeCnt++;
-			return RC_OK;
+	for(int j = kept; j < n; j++) {
+		listPushHead(nw, BM_LIST_FREE, j);
+	}
+	for(int l = 0; l < BM_NUM_LISTS; l++) {
+		for(int node = mgmt->lists[l].tail; node != -1; node = mgmt->nodePrev[node]) {
+			if(node >= oldNumPages) {
+				if(excess > 0) {
+					excess--;
+					continue;
+				}
+				remap[node] = ghostAlloc(nw, mgmt->ghostPages[node]);
+			}
+			if(remap[node] != -1) {
+				listPushHead(nw, l, remap[node]);
+			}
 		}
 	}
 
-    return RC_READ_NON_EXISTING_PAGE;
+	nw->handHot = nw->handCold = nw->handTest = -1;
+	nw->cpHot = nw->cpGhosts = 0;
+	if(mgmt->handHot == -1) {
+		return;
+	}
+	int node = mgmt->handHot;
+	do {
+		if(node >= oldNumPages) {
+			if(excess > 0) {
+				excess--;
+			}
+			else {
+				remap[node] = ghostAlloc(nw, mgmt->ghostPages[node]);
+			}
+		}
+		int m = remap[node];
+		if(m != -1) {
+			nw->cpFlags[m] = mgmt->cpFlags[node];
+			if(m >= n) {
+				nw->cpGhosts++;
+			}
+			else if(nw->cpFlags[m] & CP_HOT) {
+				nw->cpHot++;
+			}
+			ringInsertBefore(nw, nw->handHot, m);
+		}
+		node = mgmt->nodeNext[node];
+	} while(node != mgmt->handHot);
+	if(nw->handHot != -1) {
+		nw->handHot = remapHand(mgmt, remap, mgmt->handHot);
+		nw->handCold = remapHand(mgmt, remap, mgmt->handCold);
+		nw->handTest = remapHand(mgmt, remap, mgmt->handTest);
+	}
 }
 
-RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page,
-        const PageNumber pageNum) {
-
-	if(bm->mgmtData == NULL){
-		return RC_NON_EXISTING_BUFFERPOOL;
+// copies the LFU buckets of mgmt into nw (room for n frames), keeping each bucket's order; the
+// new frames kept..n-1 get count 0. Frames keep their hitNum, which other strategies use for
+// their own counters
+static void rebuildBuckets(BM_PoolMgmt *mgmt, BM_PoolMgmt *nw, int *remap, int n, int kept) {
+	for(int b = 0; b <= n; b++) {
+		nw->buckets[b].next = (b < n) ? b + 1 : -1;
 	}
+	nw->bucketFree = 0;
+	nw->bucketFirst = -1;
 
-	PageFrame *pf = (PageFrame *) bm->mgmtData;
-
-	globalHitCount++;
-	if(pageNum<0){
-		return RC_READ_NON_EXISTING_PAGE;
+	int nb = -1;
+	for(int b = mgmt->bucketFirst; b != -1; b = mgmt->buckets[b].next) {
+		nb = lfuBucketFor(nw, nb, mgmt->buckets[b].freq);
+		for(int i = mgmt->buckets[b].tail; i != -1; i = mgmt->frames[i].lfuPrev) {
+			int m = remap[i];
+			if(m != -1) {
+				int hits = nw->frames[m].hitNum;
+				lfuPushHead(nw, nb, m);
+				nw->frames[m].hitNum = hits;
+			}
+		}
+		if(nw->buckets[nb].head == -1) {
+			int prev = nw->buckets[nb].prev;
+			lfuReleaseIfEmpty(nw, nb);
+			nb = prev;
+		}
 	}
-	// check if the page already exists, if so - increment its fixCount and update the hitNum
-	for(int i = 0; i < bm->numPages; i++) {
-		if(pf[i].pageNum == pageNum) {
+	if(kept < n) {
+		int empty = lfuBucketFor(nw, -1, 0);
+		for(int j = kept; j < n; j++) {
+			lfuPushHead(nw, empty, j);
+		}
+	}
+}
 
-			pf[i].fixCount++;
+// gives one shard, whose latch is held, n frames: the frames it has (except the placeholders
+// evictFrames parked) keep their pages, pins, latches and replacement state, and a grown shard
+// gets empty frames at the victim end. FIFO and CLOCK frames are renumbered from the hand on, so
+// the queue and the clock keep their order with the hand at frame 0
+static RC rebuildFrames(BM_BufferPool *const bm, int n) {
+	BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+	PageFrame *pf = mgmt->frames;
+	int oldNumPages = bm->numPages, K = mgmt->K;
+	int kept = (n < oldNumPages) ? n : oldNumPages;
 
-			switch(bm->strategy) {
-				case RS_LRU_K:
-					{
-						// shift the accesses to the right
-						for(int j = K - 1; j > 0; j--) {
-							pf[i].LRU_array[j] = pf[i].LRU_array[j-1];
-						}
-					}
-					break;
-				case RS_LFU:
-					pf[i].hitNum++;
-					break;
-			}
-			pf[i].LRU_array[0] = globalHitCount;
+	// a grown shard first uses the slots its chunks have free (every slot but those of the kept
+	// frames and the spare), and only gets a new chunk for the rest
+	int freeSlots = -kept - (mgmt->spare != NULL ? 1 : 0);
+	for(BM_FrameChunk *chunk = mgmt->chunks; chunk != NULL; chunk = chunk->next) {
+		freeSlots += chunk->count;
+	}
+	if(n - kept > freeSlots && chunkAlloc(mgmt, n - kept - freeSlots) == NULL) {
+		return RC_WRITE_FAILED;
+	}
 
-			page->pageNum = pageNum;
-			page->data = pf[i].data;
+	// the list, heap and bucket helpers build the new state in nw, with the old one still readable
+	BM_PoolMgmt nw;
+	nw.files = mgmt->files;
+	nw.K = K;
+	nw.frames = (PageFrame *) malloc(n * sizeof(PageFrame));
+	nw.history = (int *) calloc((size_t)n * K, sizeof(int));
 
-			return RC_OK;
-		}
+	int *remap = (int *) malloc(2 * oldNumPages * sizeof(int));
+	for(int node = 0; node < 2 * oldNumPages; node++) {
+		remap[node] = -1;
 	}
-
-	int pin_cnt = 0;
-	for(int j = 0;j < bm->numPages; j++){
-		if(pf[j].fixCount != 0){
-			pin_cnt++;
+	int hand = 0;
+	if(bm->strategy == RS_FIFO) {
+		hand = mgmt->front;
+	}
+	else if(bm->strategy == RS_CLOCK) {
+		hand = mgmt->clock % oldNumPages;
+	}
+	int resident = 0, pinned = 0;
+	pageMapInit(&nw.frameMap, n);
+	for(int k = 0, j = 0; k < oldNumPages; k++) {
+		int i = (hand + k) % oldNumPages;
+		if(pf[i].pageNum < NO_PAGE) {
+			continue;
 		}
+		remap[i] = j;
+		nw.frames[j] = pf[i];
+		nw.frames[j].LRU_array = nw.history + (size_t)j * K;
+		memcpy(nw.frames[j].LRU_array, pf[i].LRU_array, K * sizeof(int));
+		if(pf[i].pageNum != NO_PAGE) {
+			pageMapPut(&nw.frameMap, pf[i].pageNum, j);
+			resident++;
+		}
+		if(pf[i].fixCount > 0) {
+			pinned++;
+		}
+		j++;
 	}
-	if(pin_cnt == bm->numPages){
-		return RC_REPLACE_WHILE_PINNED_PAGES;
+
+	// the placeholders' slots go to the new frames, then chunks a shrink emptied are given back
+	chunkScan(mgmt, nw.frames, kept);
+	for(int j = kept; j < n; j++) {
+		SM_PageHandle data = chunkTakeData(mgmt, NULL, &nw.frames[j].data);
+		frameInit(&nw.frames[j], data, chunkTakeLatch(mgmt, NULL, &nw.frames[j]), nw.history + (size_t)j * K);
 	}
+	chunkCompact(mgmt);
+	chunkScanDone(mgmt);
 
-	// else we need to read the pageFile
-	PageFrame *newPage = (PageFrame *) malloc(sizeof(PageFrame));
+	nw.nodePrev = (int *) malloc(2 * n * sizeof(int));
+	nw.nodeNext = (int *) malloc(2 * n * sizeof(int));
+	nw.nodeList = (int *) malloc(2 * n * sizeof(int));
+	nw.ghostPages = (PageNumber *) malloc(2 * n * sizeof(PageNumber));
+	nw.cpFlags = (int *) calloc(2 * n, sizeof(int));
+	rebuildNodes(mgmt, &nw, remap, oldNumPages, n, kept);
 
-	SM_FileHandle fh;
-	openPageFile(bm->pageFile, &fh);
-	newPage->data = (SM_PageHandle) malloc(PAGE_SIZE);
-	ensureCapacity(pageNum + 1, &fh);
+	nw.heap = (int *) malloc(n * sizeof(int));
+	nw.heapPos = (int *) malloc(n * sizeof(int));
+	nw.heapSize = 0;
+	for(int j = 0; j < n; j++) {
+		nw.heapPos[j] = -1;
+		if(bm->strategy == RS_LRU_K && nw.frames[j].fixCount == 0) {
+			heapInsert(&nw, j);
+		}
+	}
+	nw.buckets = (LFU_Bucket *) malloc((n + 1) * sizeof(LFU_Bucket));
+	rebuildBuckets(mgmt, &nw, remap, n, kept);
 
-	readBlock(pageNum, &fh, newPage->data);
-	newPage->pageNum = pageNum;
-	newPage->isDirty = 0;
-	newPage->fixCount = 1;
-	page->pageNum = pageNum;
-	page->data = newPage->data;
-	readCnt++;
-	closePageFile(&fh);
+	// a shared cache's per-file lists keep their order under the new frame numbers
+	nw.fileNext = (int *) malloc(n * sizeof(int));
+	nw.filePrev = (int *) malloc(n * sizeof(int));
+	nw.fileHead = nw.fileTail = NULL;
+	nw.fileLists = 0;
+	for(int f = 0; f < mgmt->fileLists; f++) {
+		for(int i = mgmt->fileTail[f]; i != -1; i = mgmt->filePrev[i]) {
+			fileListPushHead(&nw, remap[i], f);
+		}
+	}
+	free(remap);
 
-	switch(bm->strategy) {
-		case RS_FIFO: // Using FIFO algorithm
-			FIFO(bm, newPage);
-			break;
+	free(mgmt->frames);
+	free(mgmt->history);
+	free(mgmt->nodePrev);
+	free(mgmt->nodeNext);
+	free(mgmt->nodeList);
+	free(mgmt->ghostPages);
+	free(mgmt->cpFlags);
+	free(mgmt->heap);
+	free(mgmt->heapPos);
+	free(mgmt->buckets);
+	pageMapFree(&mgmt->frameMap);
+	pageMapFree(&mgmt->ghostMap);
+	// no write-back is in flight during a resize, the map is empty
+	pageMapFree(&mgmt->wbMap);
+	pageMapInit(&mgmt->wbMap, n);
+	free(mgmt->fileNext);
+	free(mgmt->filePrev);
+	free(mgmt->fileHead);
+	free(mgmt->fileTail);
+	mgmt->fileNext = nw.fileNext;
+	mgmt->filePrev = nw.filePrev;
+	mgmt->fileHead = nw.fileHead;
+	mgmt->fileTail = nw.fileTail;
+	mgmt->fileLists = nw.fileLists;
+	mgmt->frames = nw.frames;
+	mgmt->history = nw.history;
+	mgmt->frameMap = nw.frameMap;
+	memcpy(mgmt->lists, nw.lists, sizeof(nw.lists));
+	mgmt->nodePrev = nw.nodePrev;
+	mgmt->nodeNext = nw.nodeNext;
+	mgmt->nodeList = nw.nodeList;
+	mgmt->ghostPages = nw.ghostPages;
+	mgmt->ghostMap = nw.ghostMap;
+	mgmt->ghostFree = nw.ghostFree;
+	mgmt->cpFlags = nw.cpFlags;
+	mgmt->handHot = nw.handHot;
+	mgmt->handCold = nw.handCold;
+	mgmt->handTest = nw.handTest;
+	mgmt->cpHot = nw.cpHot;
+	mgmt->cpGhosts = nw.cpGhosts;
+	mgmt->heap = nw.heap;
+	mgmt->heapPos = nw.heapPos;
+	mgmt->heapSize = nw.heapSize;
+	mgmt->buckets = nw.buckets;
+	mgmt->bucketFirst = nw.bucketFirst;
+	mgmt->bucketFree = nw.bucketFree;
+	mgmt->pinnedFrames = pinned;
+	bm->numPages = n;
 
-		case RS_LRU: // Using LRU algorithm, LRU is simply LRU-K with K=1
-			LRU_K(bm, newPage);
-			break;
+	// sizes that follow the number of frames, as initFrames sets them
+	mgmt->front = 0;
+	mgmt->rear = resident - 1;
+	mgmt->clock = 0;
+	if(mgmt->arcTarget > n) {
+		mgmt->arcTarget = n;
+	}
+	mgmt->kin = (n / 4 > 1) ? n / 4 : 1;
+	mgmt->kout = (n / 2 > 1) ? n / 2 : 1;
+	if(bm->strategy == RS_2Q) {
+		while(mgmt->lists[BM_LIST_A1OUT].size > mgmt->kout) {
+			ghostDrop(mgmt, mgmt->lists[BM_LIST_A1OUT].tail);
+		}
+	}
+	if(mgmt->coldTarget > n) {
+		mgmt->coldTarget = n;
+	}
+	mgmt->prefetchReqs = (SM_AsyncRequest *) realloc(mgmt->prefetchReqs, n * sizeof(SM_AsyncRequest));
+	mgmt->prefetchLimit = (n / 2 < BM_ASYNC_QUEUE_DEPTH - 1) ? n / 2 : BM_ASYNC_QUEUE_DEPTH - 1;
+	if(mgmt->prefetchLimit < 1) {
+		mgmt->prefetchLimit = 1;
+	}
+	return RC_OK;
+}
 
-		case RS_CLOCK: // Using CLOCK algorithm
-			CLOCK(bm,newPage);
-			break;
+// every shard is latched for the whole resize, so other threads see it happen at once and a
+// shrink that some shard cannot make changes nothing
+RC resizeBufferPool(BM_BufferPool *const bm, const int newNumPages) {
+	if(bm->mgmtData == NULL){
+		return RC_NON_EXISTING_BUFFERPOOL;
+	}
+	BM_PoolMgmt *top = (BM_PoolMgmt *) bm->mgmtData;
 
-		case RS_LFU: // Using LFU algorithm
-			LFU(bm, newPage);
-			break;
+	// a pool in a shared cache owns no frames: its share of the cache is its file's quota, which
+	// its misses enforce by replacing its own pages
+	if(top->cache != NULL) {
+		if(newNumPages < 1) {
+			return RC_INVALID_POOL_SIZE;
+		}
+		pthread_mutex_lock(&top->files->lock);
+		top->files->quota[top->fileId] = newNumPages;
+		pthread_mutex_unlock(&top->files->lock);
+		return RC_OK;
+	}
+	// every shard keeps at least one frame
+	if(newNumPages < top->numShards) {
+		return RC_INVALID_POOL_SIZE;
+	}
 
-		case RS_LRU_K:	// Using LRU-K algorithm
-			LRU_K(bm, newPage);
-			break;
+	RC rc = RC_OK;
+	for(int s = 0; s < top->numShards; s++) {
+		BM_BufferPool *shard = shardAt(bm, s);
+		BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shard->mgmtData;
+		pthread_mutex_lock(&mgmt->lock);
+		// I/O done with the latch released refers to frames by index, and a prefetch may start
+		// while the latch is released for it
+		while(mgmt->prefetchInFlight > 0 || mgmt->ioInFlight > 0) {
+			if(mgmt->prefetchInFlight > 0) {
+				reapAsync(shard, 1);
+			}
+			else {
+				pthread_cond_wait(&mgmt->ioDone, &mgmt->lock);
+			}
+		}
+		// the shards split the frames as initPool does
+		int share = newNumPages / top->numShards + (s < newNumPages % top->numShards ? 1 : 0);
+		if(mgmt->pinnedFrames > share) {
+			rc = RC_REPLACE_WHILE_PINNED_PAGES;
+		}
+	}
 
-		default:
-			printf("\nNone\n");
-			break;
+	int numPages = 0;
+	for(int s = 0; s < top->numShards; s++) {
+		BM_BufferPool *shard = shardAt(bm, s);
+		BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shard->mgmtData;
+		int share = newNumPages / top->numShards + (s < newNumPages % top->numShards ? 1 : 0);
+		if(rc == RC_OK && share != shard->numPages) {
+			if(share < shard->numPages) {
+				evictFrames(shard, shard->numPages - share);
+			}
+			rc = rebuildFrames(shard, share);
+			// pins waiting for a free frame can retry in a grown shard
+			pthread_cond_broadcast(&mgmt->frameFreed);
+		}
+		numPages += shard->numPages;
 	}
-	return RC_OK;
+	if(top->numShards > 1) {
+		bm->numPages = numPages;
+	}
+	for(int s = top->numShards - 1; s >= 0; s--) {
+		pthread_mutex_unlock(&((BM_PoolMgmt *) shardAt(bm, s)->mgmtData)->lock);
+	}
+	return rc;
 }
 
+// length of the arrays the frame getters return: the frames there are now, but never fewer than
+// bm->numPages, which callers index them by. A pool opened in a shared cache keeps the cache's size
+// at the time it was opened there, so after the cache shrinks the missing frames read as empty
+static int statLength(BM_BufferPool *const bm, int numPages) {
+    return (numPages > bm->numPages) ? numPages : bm->numPages;
+}
 
+// a pool opened in a shared cache sees all of the cache's frames, those holding other files'
+// pages as empty
 PageNumber *getFrameContents (BM_BufferPool *const bm) {
-   PageFrame *pf = (PageFrame *) bm->mgmtData;
-   pageNums = (PageNumber *) malloc (sizeof(PageNumber) * bm->numPages);
-
-   int i=0;
-   while(i<bm->numPages){
-        pageNums[i] = pf[i].pageNum;
-        i++;
-   }
-   return pageNums;
+    // the frames of a sharded pool are listed shard after shard
+    int f, n = 0;
+    BM_BufferPool *pool = framesOf(bm, &f);
+    int length = statLength(bm, lockShards(pool));
+    PageNumber *pageNums = (PageNumber *) malloc(sizeof(PageNumber) * length);
+    for(int s = 0; s < ((BM_PoolMgmt *) pool->mgmtData)->numShards; s++) {
+        BM_BufferPool *shard = shardAt(pool, s);
+        BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shard->mgmtData;
+        for(int i = 0; i < shard->numPages; i++) {
+            PageFrame *frame = &mgmt->frames[i];
+            bool shown = frame->pageNum != NO_PAGE && frameOfFile(frame, f);
+            pageNums[n++] = shown ? BM_PAGE_OF(frame->pageNum) : NO_PAGE;
+        }
+    }
+    unlockShards(pool);
+    while(n < length) {
+        pageNums[n++] = NO_PAGE;
+    }
+    return pageNums;
 }
 
 //iterate all the frames, update the value of dirty flags, then return result.
 bool *getDirtyFlags (BM_BufferPool *const bm) {
-    PageFrame *pf = (PageFrame *) bm->mgmtData;
-    dirtyFlags = (bool *) malloc (sizeof(bool) * bm->numPages);
-
-    int i=0;
-    while(i<bm->numPages){
-        dirtyFlags[i] = pf[i].isDirty;
-        i++;
+    int f, n = 0;
+    BM_BufferPool *pool = framesOf(bm, &f);
+    int length = statLength(bm, lockShards(pool));
+    bool *dirtyFlags = (bool *) calloc(length, sizeof(bool));
+    for(int s = 0; s < ((BM_PoolMgmt *) pool->mgmtData)->numShards; s++) {
+        BM_BufferPool *shard = shardAt(pool, s);
+        BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shard->mgmtData;
+        for(int i = 0; i < shard->numPages; i++) {
+            PageFrame *frame = &mgmt->frames[i];
+            dirtyFlags[n++] = frameOfFile(frame, f) && frame->isDirty;
+        }
     }
+    unlockShards(pool);
     return dirtyFlags;
 }
 
 
 //iterate all the frames, update the value of fix count, then return result.
 int *getFixCounts (BM_BufferPool *const bm) {
-    PageFrame *pf = (PageFrame *) bm->mgmtData;
-    fixCounts = (int *) malloc(sizeof(int) * bm->numPages);
-
-    int i=0;
-    while(i<bm->numPages){
-        fixCounts[i] = pf[i].fixCount;
-        i++;
+    int f, n = 0;
+    BM_BufferPool *pool = framesOf(bm, &f);
+    int length = statLength(bm, lockShards(pool));
+    int *fixCounts = (int *) calloc(length, sizeof(int));
+    for(int s = 0; s < ((BM_PoolMgmt *) pool->mgmtData)->numShards; s++) {
+        BM_BufferPool *shard = shardAt(pool, s);
+        BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shard->mgmtData;
+        for(int i = 0; i < shard->numPages; i++) {
+            PageFrame *frame = &mgmt->frames[i];
+            fixCounts[n++] = frameOfFile(frame, f) ? frame->fixCount : 0;
+        }
     }
-
+    unlockShards(pool);
     return fixCounts;
 }
 
+// a pool opened in a shared cache counts the I/Os done on its own file
 int getNumReadIO (BM_BufferPool *const bm) {
-    return readCnt;
+    BM_PoolMgmt *top = (BM_PoolMgmt *) bm->mgmtData;
+    int count = 0;
+    if(top->cache != NULL) {
+        pthread_mutex_lock(&top->files->lock);
+        count = top->files->reads[top->fileId];
+        pthread_mutex_unlock(&top->files->lock);
+        return count;
+    }
+    for(int s = 0; s < top->numShards; s++) {
+        BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shardAt(bm, s)->mgmtData;
+        pthread_mutex_lock(&mgmt->lock);
+        count += mgmt->readCnt;
+        pthread_mutex_unlock(&mgmt->lock);
+    }
+    return count;
 }
 
 int getNumWriteIO (BM_BufferPool *const bm) {
-    return writeCnt;
+    BM_PoolMgmt *top = (BM_PoolMgmt *) bm->mgmtData;
+    int count = 0;
+    if(top->cache != NULL) {
+        pthread_mutex_lock(&top->files->lock);
+        count = top->files->writes[top->fileId];
+        pthread_mutex_unlock(&top->files->lock);
+        return count;
+    }
+    for(int s = 0; s < top->numShards; s++) {
+        BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shardAt(bm, s)->mgmtData;
+        pthread_mutex_lock(&mgmt->lock);
+        count += mgmt->writeCnt;
+        pthread_mutex_unlock(&mgmt->lock);
+    }
+    return count;
+}
+
+// size of the pages in the pool's file; for a shared cache the size of its frames
+int getPoolPageSize (BM_BufferPool *const bm) {
+    BM_PoolMgmt *mgmt = (BM_PoolMgmt *) bm->mgmtData;
+    if(mgmt->cache == NULL) {
+        return mgmt->files->pageSize;
+    }
+    pthread_mutex_lock(&mgmt->files->lock);
+    int pageSize = mgmt->files->handles[mgmt->fileId]->pageSize;
+    pthread_mutex_unlock(&mgmt->files->lock);
+    return pageSize;
+}
+
+// counters are kept per shard and summed here; a pool opened in a shared cache reports the
+// cache's counters and latencies, but its own dirty pages and I/O counts
+RC getPoolStats (BM_BufferPool *const bm, BM_PoolStats *stats) {
+    if(bm->mgmtData == NULL) {
+        return RC_NON_EXISTING_BUFFERPOOL;
+    }
+    memset(stats, 0, sizeof(BM_PoolStats));
+
+    int f;
+    BM_BufferPool *pool = framesOf(bm, &f);
+    BM_PoolMgmt *top = (BM_PoolMgmt *) pool->mgmtData;
+    stats->numPages = lockShards(pool);
+    for(int s = 0; s < top->numShards; s++) {
+        BM_BufferPool *shard = shardAt(pool, s);
+        BM_PoolMgmt *mgmt = (BM_PoolMgmt *) shard->mgmtData;
+        for(int i = 0; i < shard->numPages; i++) {
+            PageFrame *frame = &mgmt->frames[i];
+            stats->dirtyPages += (frameOfFile(frame, f) && frame->isDirty) ? 1 : 0;
+        }
+        stats->hits += mgmt->hits;
+        stats->misses += mgmt->misses;
+        stats->cleanEvictions += mgmt->cleanEvictions;
+        stats->dirtyEvictions += mgmt->dirtyEvictions;
+        stats->pinWaits += mgmt->pinWaits;
+        stats->failedPins += mgmt->failedPins;
+        stats->victimSearches += mgmt->victimSearches;
+        stats->victimSearchSteps += mgmt->victimSearchSteps;
+    }
+    unlockShards(pool);
+    stats->evictions = stats->cleanEvictions + stats->dirtyEvictions;
+    if(stats->hits + stats->misses > 0) {
+        stats->hitRatio = (double) stats->hits / (double) (stats->hits + stats->misses);
+    }
+
+    stats->numReadIO = getNumReadIO(bm);
+    stats->numWriteIO = getNumWriteIO(bm);
+    pthread_mutex_lock(&top->files->lock);
+    stats->readLatency = top->files->readLatency;
+    stats->writeLatency = top->files->writeLatency;
+    pthread_mutex_unlock(&top->files->lock);
+    return RC_OK;
 }
@@ -7,17 +7,22 @@
 // Include bool DT
 #include "dt.h"
 
+// Include SM_IOMode
+#include "storage_mgr.h"
+
 // Replacement Strategies
 typedef enum ReplacementStrategy {
 	RS_FIFO = 0,
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_ARC = 5,
+	RS_2Q = 6,
+	RS_CLOCK_PRO = 7
 } ReplacementStrategy;
 
-// Data Types and Structures
-typedef int PageNumber;
+// Data Types and Structures (PageNumber comes from dt.h)
 #define NO_PAGE -1
 
 typedef struct BM_BufferPool {
@@ -28,11 +33,73 @@ typedef struct BM_BufferPool {
 	// manager needs for a buffer pool
 } BM_BufferPool;
 
+// Optional pool settings; fill with initPoolConfig and override what you need
+typedef struct BM_PoolConfig {
+	SM_IOMode ioMode; // how the page file is opened, e.g. SM_IO_DIRECT to skip the kernel page cache
+	bool useAsyncIO;  // overlap a miss's read with the write-back of a dirty victim
+	int lfuAgingInterval; // RS_LFU: halve all use counts every this many pinPage calls, 0 = never
+	int clockMaxCount;    // RS_CLOCK: saturation limit of a frame's usage counter, 1 = plain CLOCK
+	bool backgroundWriter;   // a thread writes dirty, unpinned frames back so victims are usually clean
+	int bgDirtyHighPercent;  // background writer: start writing once more than this share of frames is dirty
+	int bgDirtyLowPercent;   // background writer: stop once the dirty share is down to this
+	int bgMaxWritesPerRound; // background writer: pages written per round at most, 0 = no limit
+	int bgIntervalMs;        // background writer: time between rounds
+	int numShards;           // split the frames into this many shards by page number hash, each with
+	                         // its own page map, replacement state and latch (1 = one shard)
+	int pinWaitTimeoutMs;    // a pin that finds every frame pinned waits this long for an unpin
+	                         // before failing; 0 = fail at once, -1 = wait forever
+	const char *warmupManifest; // shutdownBufferPool writes the resident pages here, hottest first,
+	                            // and init reloads them in the background; NULL = no warm-up
+	bool syncOnFlush;        // forceFlushPool and shutdownBufferPool end with one fdatasync of the
+	                         // page file, so the flushed pages are durable
+} BM_PoolConfig;
+
+// default BM_PoolConfig.clockMaxCount
+#define BM_CLOCK_MAX_COUNT 3
+
+// content latch a pinned page is held with (see pinPageShared/pinPageExclusive)
+typedef enum BM_LatchMode {
+	BM_LATCH_NONE = 0,
+	BM_LATCH_SHARED = 1,
+	BM_LATCH_EXCLUSIVE = 2
+} BM_LatchMode;
+
 typedef struct BM_PageHandle {
 	PageNumber pageNum;
 	char *data;
+	BM_LatchMode latchMode; // set by the pin calls, unpinPage releases the latch
 } BM_PageHandle;
 
+// buckets of a latency histogram: bucket b counts the storage manager calls that took at most
+// 2^b microseconds (and longer than the bucket before), the last bucket every slower call
+#define BM_LATENCY_BUCKETS 20
+
+typedef struct BM_LatencyHistogram {
+	long count;
+	long sumMicros;
+	long buckets[BM_LATENCY_BUCKETS];
+} BM_LatencyHistogram;
+
+// snapshot of a pool's counters since it was initialized (see getPoolStats)
+typedef struct BM_PoolStats {
+	int numPages;
+	int dirtyPages;          // frames holding a dirty page right now
+	long hits;               // pins that found their page resident
+	long misses;             // pins that had to read their page
+	double hitRatio;         // hits / (hits + misses), 0 before the first pin
+	long evictions;          // pages replaced to make room: cleanEvictions + dirtyEvictions
+	long cleanEvictions;
+	long dirtyEvictions;     // victims that were written back first
+	long pinWaits;           // pins that found every frame pinned and waited for an unpin
+	long failedPins;         // pins that failed with RC_REPLACE_WHILE_PINNED_PAGES
+	long victimSearches;     // victims the replacement strategy picked
+	long victimSearchSteps;  // frames, list entries or clock positions it examined doing so
+	int numReadIO;           // as getNumReadIO and getNumWriteIO
+	int numWriteIO;
+	BM_LatencyHistogram readLatency;  // synchronous page reads and writes, one entry per call
+	BM_LatencyHistogram writeLatency; // (a vectored call covers several pages)
+} BM_PoolStats;
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -44,8 +111,23 @@ typedef struct BM_PageHandle {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
+RC initBufferPoolWithConfig(BM_BufferPool *const bm, const char *const pageFileName,
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, const BM_PoolConfig *config);
+void initPoolConfig(BM_PoolConfig *config);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+// grows or shrinks a pool while it is in use: a shrink writes back and evicts the victims the
+// replacement strategy picks, and fails if too many frames are pinned
+RC resizeBufferPool(BM_BufferPool *const bm, const int newNumPages);
+
+// Buffer Manager Interface Shared Caches: one set of frames (of pageSize bytes) holding pages
+// of many page files. A pool opened in a cache is used like any other pool; maxFrames caps the
+// frames its file may take (0 = no limit). Shut those pools down before the cache itself
+RC initBufferCache(BM_BufferPool *const cache, const int numPages, const int pageSize,
+		ReplacementStrategy strategy, void *stratData, const BM_PoolConfig *config);
+RC openPoolInCache(BM_BufferPool *const bm, BM_BufferPool *const cache,
+		const char *const pageFileName, const int maxFrames);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -54,11 +136,36 @@ RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
 
+// Buffer Manager Interface Page Latches: pin a page and hold its content latch, shared for
+// readers or exclusive for a writer, until unpinPage; several threads may share one pool
+RC pinPageShared (BM_BufferPool *const bm, BM_PageHandle *const page,
+		const PageNumber pageNum);
+RC pinPageExclusive (BM_BufferPool *const bm, BM_PageHandle *const page,
+		const PageNumber pageNum);
+
+// Buffer Manager Interface Prefetching: start reading pages into unpinned frames without
+// waiting, so that a later pinPage hits; returns before the reads finish
+RC prefetchPage (BM_BufferPool *const bm, const PageNumber pageNum);
+RC prefetchRange (BM_BufferPool *const bm, const PageNumber firstPage, const int count);
+
+// Buffer Manager Interface Scan Rings: a sequential scan pins (and prefetches) its pages through
+// a small private ring of frames that it keeps recycling, so it does not push hot pages out
+#define BM_SCAN_RING_SIZE 32
+typedef struct BM_ScanRing BM_ScanRing;
+RC initScanRing (BM_BufferPool *const bm, BM_ScanRing **ring, int numFrames);
+RC freeScanRing (BM_ScanRing *ring);
+RC pinPageWithRing (BM_BufferPool *const bm, BM_PageHandle *const page,
+		const PageNumber pageNum, BM_ScanRing *ring);
+RC prefetchRangeWithRing (BM_BufferPool *const bm, const PageNumber firstPage, const int count,
+		BM_ScanRing *ring);
+
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
 bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getPoolPageSize (BM_BufferPool *const bm);
+RC getPoolStats (BM_BufferPool *const bm, BM_PoolStats *stats);
 
 #endif
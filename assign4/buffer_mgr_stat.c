@@ -3,9 +3,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 
 // local functions
 static void printStrat (BM_BufferPool *const bm);
+static void printPageBytes (BM_PageHandle *const page, int pageSize);
+static char *sprintPageBytes (BM_PageHandle *const page, int pageSize);
+static const char *stratName (ReplacementStrategy strategy);
+static void append (char **buf, int *len, int *cap, const char *fmt, ...);
+static void appendQuoted (char **buf, int *len, int *cap, const char *str);
+static void appendHistogramJSON (char **buf, int *len, int *cap, BM_LatencyHistogram *hist);
+static void appendHistogramProm (char **buf, int *len, int *cap, const char *name,
+		const char *help, const char *labels, BM_LatencyHistogram *hist);
 
 // external functions
 void 
@@ -25,7 +34,7 @@ printPoolContent (BM_BufferPool *const bm)
 	printf(" %i}: ", bm->numPages);
 
 	for (i = 0; i < bm->numPages; i++)
-		printf("%s[%i%s%i]", ((i == 0) ? "" : ",") , frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
+		printf("%s[%lld%s%i]", ((i == 0) ? "" : ",") , (long long) frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
 	printf("\n");
 }
 
@@ -39,13 +48,13 @@ sprintPoolContent (BM_BufferPool *const bm)
 	char *message;
 	int pos = 0;
 
-	message = (char *) malloc(256 + (22 * bm->numPages));
 	frameContent = getFrameContents(bm);
 	dirty = getDirtyFlags(bm);
 	fixCount = getFixCounts(bm);
+	message = (char *) malloc(256 + (22 * bm->numPages));
 
 	for (i = 0; i < bm->numPages; i++)
-		pos += sprintf(message + pos, "%s[%i%s%i]", ((i == 0) ? "" : ",") , frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
+		pos += sprintf(message + pos, "%s[%lld%s%i]", ((i == 0) ? "" : ",") , (long long) frameContent[i], (dirty[i] ? "x": " "), fixCount[i]);
 
 	return message;
 }
@@ -53,27 +62,143 @@ sprintPoolContent (BM_BufferPool *const bm)
 
 void
 printPageContent (BM_PageHandle *const page)
+{
+	printPageBytes(page, PAGE_SIZE);
+}
+
+char *
+sprintPageContent (BM_PageHandle *const page)
+{
+	return sprintPageBytes(page, PAGE_SIZE);
+}
+
+// the page as large as bm's frames are, for pools on files with another page size
+void
+printPoolPageContent (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+	printPageBytes(page, getPoolPageSize(bm));
+}
+
+char *
+sprintPoolPageContent (BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+	return sprintPageBytes(page, getPoolPageSize(bm));
+}
+
+// the pool's counters as one JSON object
+char *
+sprintPoolStatsJSON (BM_BufferPool *const bm)
+{
+	BM_PoolStats stats;
+	char *buf = NULL;
+	int len = 0, cap = 0;
+
+	if (getPoolStats(bm, &stats) != RC_OK)
+		return NULL;
+
+	append(&buf, &len, &cap, "{\"pool\":");
+	appendQuoted(&buf, &len, &cap, bm->pageFile);
+	append(&buf, &len, &cap, ",\"strategy\":");
+	appendQuoted(&buf, &len, &cap, stratName(bm->strategy));
+	append(&buf, &len, &cap, ",\"numPages\":%i,\"dirtyPages\":%i", stats.numPages, stats.dirtyPages);
+	append(&buf, &len, &cap, ",\"hits\":%ld,\"misses\":%ld,\"hitRatio\":%.6f",
+			stats.hits, stats.misses, stats.hitRatio);
+	append(&buf, &len, &cap, ",\"evictions\":%ld,\"cleanEvictions\":%ld,\"dirtyEvictions\":%ld",
+			stats.evictions, stats.cleanEvictions, stats.dirtyEvictions);
+	append(&buf, &len, &cap, ",\"pinWaits\":%ld,\"failedPins\":%ld", stats.pinWaits, stats.failedPins);
+	append(&buf, &len, &cap, ",\"victimSearches\":%ld,\"victimSearchSteps\":%ld",
+			stats.victimSearches, stats.victimSearchSteps);
+	append(&buf, &len, &cap, ",\"numReadIO\":%i,\"numWriteIO\":%i", stats.numReadIO, stats.numWriteIO);
+	append(&buf, &len, &cap, ",\"readLatency\":");
+	appendHistogramJSON(&buf, &len, &cap, &stats.readLatency);
+	append(&buf, &len, &cap, ",\"writeLatency\":");
+	appendHistogramJSON(&buf, &len, &cap, &stats.writeLatency);
+	append(&buf, &len, &cap, "}");
+
+	return buf;
+}
+
+// the pool's counters in the Prometheus text exposition format, labelled with the pool's page
+// file and strategy; latencies are histograms in microseconds
+char *
+sprintPoolStatsPrometheus (BM_BufferPool *const bm)
+{
+	BM_PoolStats stats;
+	char *buf = NULL, *labels = NULL;
+	int len = 0, cap = 0, labelsLen = 0, labelsCap = 0;
+
+	if (getPoolStats(bm, &stats) != RC_OK)
+		return NULL;
+
+	append(&labels, &labelsLen, &labelsCap, "pool=");
+	appendQuoted(&labels, &labelsLen, &labelsCap, bm->pageFile);
+	append(&labels, &labelsLen, &labelsCap, ",strategy=");
+	appendQuoted(&labels, &labelsLen, &labelsCap, stratName(bm->strategy));
+
+	append(&buf, &len, &cap, "# HELP bm_frames Frames in the buffer pool.\n# TYPE bm_frames gauge\n");
+	append(&buf, &len, &cap, "bm_frames{%s} %i\n", labels, stats.numPages);
+	append(&buf, &len, &cap, "# HELP bm_dirty_pages Frames holding a dirty page.\n# TYPE bm_dirty_pages gauge\n");
+	append(&buf, &len, &cap, "bm_dirty_pages{%s} %i\n", labels, stats.dirtyPages);
+	append(&buf, &len, &cap, "# HELP bm_hits_total Pins that found their page resident.\n# TYPE bm_hits_total counter\n");
+	append(&buf, &len, &cap, "bm_hits_total{%s} %ld\n", labels, stats.hits);
+	append(&buf, &len, &cap, "# HELP bm_misses_total Pins that had to read their page.\n# TYPE bm_misses_total counter\n");
+	append(&buf, &len, &cap, "bm_misses_total{%s} %ld\n", labels, stats.misses);
+	append(&buf, &len, &cap, "# HELP bm_hit_ratio Hits per pin.\n# TYPE bm_hit_ratio gauge\n");
+	append(&buf, &len, &cap, "bm_hit_ratio{%s} %.6f\n", labels, stats.hitRatio);
+	append(&buf, &len, &cap, "# HELP bm_evictions_total Pages replaced to make room, by whether they were written back.\n"
+			"# TYPE bm_evictions_total counter\n");
+	append(&buf, &len, &cap, "bm_evictions_total{%s,kind=\"clean\"} %ld\n", labels, stats.cleanEvictions);
+	append(&buf, &len, &cap, "bm_evictions_total{%s,kind=\"dirty\"} %ld\n", labels, stats.dirtyEvictions);
+	append(&buf, &len, &cap, "# HELP bm_pin_waits_total Pins that waited for a frame to be unpinned.\n"
+			"# TYPE bm_pin_waits_total counter\n");
+	append(&buf, &len, &cap, "bm_pin_waits_total{%s} %ld\n", labels, stats.pinWaits);
+	append(&buf, &len, &cap, "# HELP bm_failed_pins_total Pins that found every frame pinned.\n"
+			"# TYPE bm_failed_pins_total counter\n");
+	append(&buf, &len, &cap, "bm_failed_pins_total{%s} %ld\n", labels, stats.failedPins);
+	append(&buf, &len, &cap, "# HELP bm_victim_searches_total Victims picked by the replacement strategy.\n"
+			"# TYPE bm_victim_searches_total counter\n");
+	append(&buf, &len, &cap, "bm_victim_searches_total{%s} %ld\n", labels, stats.victimSearches);
+	append(&buf, &len, &cap, "# HELP bm_victim_search_steps_total Frames examined while picking victims.\n"
+			"# TYPE bm_victim_search_steps_total counter\n");
+	append(&buf, &len, &cap, "bm_victim_search_steps_total{%s} %ld\n", labels, stats.victimSearchSteps);
+	append(&buf, &len, &cap, "# HELP bm_read_pages_total Pages read from the page file.\n# TYPE bm_read_pages_total counter\n");
+	append(&buf, &len, &cap, "bm_read_pages_total{%s} %i\n", labels, stats.numReadIO);
+	append(&buf, &len, &cap, "# HELP bm_written_pages_total Pages written to the page file.\n"
+			"# TYPE bm_written_pages_total counter\n");
+	append(&buf, &len, &cap, "bm_written_pages_total{%s} %i\n", labels, stats.numWriteIO);
+	appendHistogramProm(&buf, &len, &cap, "bm_read_latency_microseconds",
+			"Time of each page file read call.", labels, &stats.readLatency);
+	appendHistogramProm(&buf, &len, &cap, "bm_write_latency_microseconds",
+			"Time of each page file write call.", labels, &stats.writeLatency);
+
+	free(labels);
+	return buf;
+}
+
+void
+printPageBytes (BM_PageHandle *const page, int pageSize)
 {
 	int i;
 
-	printf("[Page %i]\n", page->pageNum);
+	printf("[Page %lld]\n", (long long) page->pageNum);
 
-	for (i = 1; i <= PAGE_SIZE; i++)
-		printf("%02X%s%s", page->data[i], (i % 8) ? "" : " ", (i % 64) ? "" : "\n");
+	for (i = 1; i <= pageSize; i++)
+		printf("%02X%s%s", (unsigned char) page->data[i - 1], (i % 8) ? "" : " ", (i % 64) ? "" : "\n");
 }
 
 char *
-sprintPageContent (BM_PageHandle *const page)
+sprintPageBytes (BM_PageHandle *const page, int pageSize)
 {
 	int i;
 	char *message;
 	int pos = 0;
 
-	message = (char *) malloc(30 + (2 * PAGE_SIZE) + (PAGE_SIZE % 64) + (PAGE_SIZE % 8));
-	pos += sprintf(message + pos, "[Page %i]\n", page->pageNum);
+	// two hex digits a byte, a space after every 8 and a newline after every 64
+	message = (char *) malloc(30 + (2 * pageSize) + (pageSize / 8) + (pageSize / 64) + 1);
+	pos += sprintf(message + pos, "[Page %lld]\n", (long long) page->pageNum);
 
-	for (i = 1; i <= PAGE_SIZE; i++)
-		pos += sprintf(message + pos, "%02X%s%s", page->data[i], (i % 8) ? "" : " ", (i % 64) ? "" : "\n");
+	for (i = 1; i <= pageSize; i++)
+		pos += sprintf(message + pos, "%02X%s%s", (unsigned char) page->data[i - 1], (i % 8) ? "" : " ", (i % 64) ? "" : "\n");
 
 	return message;
 }
@@ -81,25 +206,115 @@ sprintPageContent (BM_PageHandle *const page)
 void
 printStrat (BM_BufferPool *const bm)
 {
-	switch (bm->strategy)
+	const char *name = stratName(bm->strategy);
+
+	if (name != NULL)
+		printf("%s", name);
+	else
+		printf("%i", bm->strategy);
+}
+
+const char *
+stratName (ReplacementStrategy strategy)
+{
+	switch (strategy)
 	{
 	case RS_FIFO:
-		printf("FIFO");
-		break;
+		return "FIFO";
 	case RS_LRU:
-		printf("LRU");
-		break;
+		return "LRU";
 	case RS_CLOCK:
-		printf("CLOCK");
-		break;
+		return "CLOCK";
 	case RS_LFU:
-		printf("LFU");
-		break;
+		return "LFU";
 	case RS_LRU_K:
-		printf("LRU-K");
-		break;
+		return "LRU-K";
+	case RS_ARC:
+		return "ARC";
+	case RS_2Q:
+		return "2Q";
+	case RS_CLOCK_PRO:
+		return "CLOCK-Pro";
 	default:
-		printf("%i", bm->strategy);
-		break;
+		return NULL;
+	}
+}
+
+// printf-style append to a buffer that grows as needed
+void
+append (char **buf, int *len, int *cap, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, fmt);
+	n = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+
+	if (*len + n + 1 > *cap)
+	{
+		*cap = (*len + n + 1 > 2 * *cap) ? *len + n + 1 : 2 * *cap;
+		*buf = (char *) realloc(*buf, *cap);
+	}
+
+	va_start(args, fmt);
+	vsnprintf(*buf + *len, n + 1, fmt, args);
+	va_end(args);
+	*len += n;
+}
+
+// str in double quotes, escaped as JSON strings and Prometheus label values both require
+void
+appendQuoted (char **buf, int *len, int *cap, const char *str)
+{
+	append(buf, len, cap, "\"");
+	for (; str != NULL && *str != '\0'; str++)
+	{
+		if (*str == '"' || *str == '\\')
+			append(buf, len, cap, "\\%c", *str);
+		else if (*str == '\n')
+			append(buf, len, cap, "\\n");
+		else
+			append(buf, len, cap, "%c", *str);
+	}
+	append(buf, len, cap, "\"");
+}
+
+// buckets are listed with their upper bound, the last one (le null) open-ended
+void
+appendHistogramJSON (char **buf, int *len, int *cap, BM_LatencyHistogram *hist)
+{
+	int b;
+
+	append(buf, len, cap, "{\"count\":%ld,\"sumMicros\":%ld,\"buckets\":[", hist->count, hist->sumMicros);
+	for (b = 0; b < BM_LATENCY_BUCKETS; b++)
+	{
+		if (b < BM_LATENCY_BUCKETS - 1)
+			append(buf, len, cap, "{\"le\":%ld,\"count\":%ld},", 1L << b, hist->buckets[b]);
+		else
+			append(buf, len, cap, "{\"le\":null,\"count\":%ld}", hist->buckets[b]);
+	}
+	append(buf, len, cap, "]}");
+}
+
+// Prometheus buckets are cumulative
+void
+appendHistogramProm (char **buf, int *len, int *cap, const char *name, const char *help,
+		const char *labels, BM_LatencyHistogram *hist)
+{
+	long cumulative = 0;
+	int b;
+
+	append(buf, len, cap, "# HELP %s %s\n", name, help);
+	append(buf, len, cap, "# TYPE %s histogram\n", name);
+	for (b = 0; b < BM_LATENCY_BUCKETS; b++)
+	{
+		cumulative += hist->buckets[b];
+		if (b < BM_LATENCY_BUCKETS - 1)
+			append(buf, len, cap, "%s_bucket{%s,le=\"%ld\"} %ld\n", name, labels, 1L << b, cumulative);
+		else
+			append(buf, len, cap, "%s_bucket{%s,le=\"+Inf\"} %ld\n", name, labels, cumulative);
 	}
+	append(buf, len, cap, "%s_sum{%s} %ld\n", name, labels, hist->sumMicros);
+	append(buf, len, cap, "%s_count{%s} %ld\n", name, labels, hist->count);
 }
@@ -8,5 +8,12 @@ void printPoolContent (BM_BufferPool *const bm);
 void printPageContent (BM_PageHandle *const page);
 char *sprintPoolContent (BM_BufferPool *const bm);
 char *sprintPageContent (BM_PageHandle *const page);
+// the same for a page of bm, whose file may not use PAGE_SIZE pages
+void printPoolPageContent (BM_BufferPool *const bm, BM_PageHandle *const page);
+char *sprintPoolPageContent (BM_BufferPool *const bm, BM_PageHandle *const page);
+
+// metrics export: the counters of getPoolStats as JSON or Prometheus text (caller frees)
+char *sprintPoolStatsJSON (BM_BufferPool *const bm);
+char *sprintPoolStatsPrometheus (BM_BufferPool *const bm);
 
 #endif
@@ -4,7 +4,7 @@
 #include "stdio.h"
 
 /* module wide constants */
-#define PAGE_SIZE 4096
+#define PAGE_SIZE 4096	// default page size; each page file records its own
 
 /* return code definitions */
 typedef int RC;
@@ -18,10 +18,13 @@ typedef int RC;
 #define RC_FILE_SEEK_ERROR 10
 #define RC_FILE_CLOSE_FAILED 11
 #define RC_FILE_DESTROY_FAILED 12
+#define RC_ASYNC_IO_UNAVAILABLE 13
+#define RC_INVALID_PAGE_SIZE 14
 
 #define RC_SHUTDOWN_WHILE_PINNED_PAGES 20
 #define RC_REPLACE_WHILE_PINNED_PAGES 21
 #define RC_NON_EXISTING_BUFFERPOOL 22
+#define RC_INVALID_POOL_SIZE 23
 
 #define RC_DELETING_UNEXISTING_RECORD 30
 #define RC_GETTING_UNEXISTING_RECORD 31
@@ -11,4 +11,9 @@
 #define TRUE true
 #define FALSE false
 
+#include <stdint.h>
+
+// page numbers and page counts are 64-bit so page files can grow past 2 GB
+typedef int64_t PageNumber;
+
 #endif // DT_H
@@ -11,14 +11,16 @@
 const int NUM_PAGES = 100;
 const ReplacementStrategy REPLACEMENT_STRATEGY = RS_LRU;
 const int TOTAL_RESERVED_PAGES = 1;            // 0th page is for table information
+const int SCAN_PREFETCH_PAGES = 4;             // record pages a scan reads ahead
 Schema *schem;
+BM_BufferPool *tableCache = NULL;              // shared cache passed to initRecordManager, if any
 
 RC checkDuplicatePrimaryKey(RM_TableData *rel, Record *record) {
     BM_PageHandle *tableInfoPage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
     pinPage(rel->mgmtData, tableInfoPage, 0);
 
     int *integerTablePointer = (int*)tableInfoPage->data;
-    int totalRecordPages = integerTablePointer[2];
+    PageNumber totalRecordPages = integerTablePointer[2];
     int maxRecordsPerPage = integerTablePointer[3];
     unpinPage(rel->mgmtData, tableInfoPage);
     free(tableInfoPage);
@@ -36,7 +38,7 @@ RC checkDuplicatePrimaryKey(RM_TableData *rel, Record *record) {
     Value *comparisionResult = (Value*)malloc(sizeof(Value));
 
     RID id;
-    for(int page = TOTAL_RESERVED_PAGES; page < totalRecordPages + TOTAL_RESERVED_PAGES; page++) {
+    for(PageNumber page = TOTAL_RESERVED_PAGES; page < totalRecordPages + TOTAL_RESERVED_PAGES; page++) {
         for(int slot = 0; slot < maxRecordsPerPage; slot++) {
 
             id.page = page;
@@ -62,20 +64,39 @@ RC checkDuplicatePrimaryKey(RM_TableData *rel, Record *record) {
     return RC_OK;
 }
 
+// mgmtData may be a buffer cache (initBufferCache) the tables then share instead of each
+// getting a private pool
 RC initRecordManager(void *mgmtData) {
     initStorageManager();
+    tableCache = (BM_BufferPool *) mgmtData;
     return RC_OK;
 }
 
 RC shutdownRecordManager() {
+    tableCache = NULL;
     return RC_OK;
 }
 
+RC openTablePool(BM_BufferPool *bufferPool, char *name) {
+    if(tableCache != NULL) {
+        return openPoolInCache(bufferPool, tableCache, name, 0);
+    }
+    return initBufferPool(bufferPool, name, NUM_PAGES, REPLACEMENT_STRATEGY, NULL);
+}
+
 RC createTable(char *name, Schema *schema) {
-    createPageFile(name);
+    return createTableWithPageSize(name, schema, PAGE_SIZE);
+}
+
+// large pages hold more records each, so scans over wide tables need fewer I/Os
+RC createTableWithPageSize(char *name, Schema *schema, int pageSize) {
+    RC rc = createPageFileWithSize(name, pageSize);
+    if(rc != RC_OK) {
+        return rc;
+    }
 
     BM_BufferPool *bufferPool = (BM_BufferPool*)malloc(sizeof(BM_BufferPool));
-    initBufferPool(bufferPool, name, NUM_PAGES, REPLACEMENT_STRATEGY, NULL);  // initialize a new buffer pool
+    openTablePool(bufferPool, name);  // initialize a new buffer pool
 
     BM_PageHandle *tableInfoPage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
     pinPage(bufferPool, tableInfoPage, 0);
@@ -87,7 +108,7 @@ RC createTable(char *name, Schema *schema) {
 
     // Each page has an integer array of length maxRecordsPerPage, which uses slotted pages to store records
     // The first sizeof(int) bytes store the number of records currently in the page
-    int maxRecordsPerPage = (PAGE_SIZE - sizeof(int))/(sizeof(int) + recordSize);
+    int maxRecordsPerPage = (pageSize - sizeof(int))/(sizeof(int) + recordSize);
 
     integerTablePointer[0] = recordSize;
     integerTablePointer[1] = 0;             // Initialize total records
@@ -103,7 +124,7 @@ RC createTable(char *name, Schema *schema) {
 
 RC openTable(RM_TableData *rel, char *name) {
     BM_BufferPool *bufferPool = (BM_BufferPool*)malloc(sizeof(BM_BufferPool));
-    initBufferPool(bufferPool, name, NUM_PAGES, REPLACEMENT_STRATEGY, NULL);  // initialize a new buffer pool
+    openTablePool(bufferPool, name);  // initialize a new buffer pool
     bufferPool->pageFile = name;
     rel->mgmtData = bufferPool;
     rel->name = name;
@@ -152,11 +173,12 @@ RC insertRecord(RM_TableData *rel, Record *record) {
     int *integerTablePointer = (int*)tableInfoPage->data;
     int recordSize = integerTablePointer[0];
     int totalRecords = integerTablePointer[1];
-    int totalRecordPages = integerTablePointer[2];
+    PageNumber totalRecordPages = integerTablePointer[2];
     int maxRecordsPerPage = integerTablePointer[3];
 
     BM_PageHandle *freePage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
-    int i = 0, totalRecordsInPage = 0;
+    PageNumber i = 0;
+    int totalRecordsInPage = 0;
 
     // if all pages are full, add another page
     if(totalRecords == totalRecordPages * maxRecordsPerPage) {
@@ -314,6 +336,7 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
     scan_cond->cond = cond;
     scan_cond->id->page = 1;
     scan_cond->id->slot = 0;
+    initScanRing(rel->mgmtData, &scan_cond->ring, BM_SCAN_RING_SIZE);
 
     scan->rel = rel;
     scan->mgmtData = scan_cond;
@@ -321,6 +344,27 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond) {
     return RC_OK;
 }
 
+// loads the page a scan moves onto through the scan's ring and starts reading the record pages
+// after it, so getRecord finds them in the pool without the scan evicting other pages
+static void enterScanPage(RM_TableData *rel, BM_ScanRing *ring, PageNumber page, PageNumber totalRecordPages) {
+    if(page > totalRecordPages) {
+        return;
+    }
+    BM_PageHandle *recordPage = (BM_PageHandle*)malloc(sizeof(BM_PageHandle));
+    if(pinPageWithRing(rel->mgmtData, recordPage, page, ring) == RC_OK) {
+        unpinPage(rel->mgmtData, recordPage);
+    }
+    free(recordPage);
+
+    PageNumber count = totalRecordPages - page;
+    if(count > SCAN_PREFETCH_PAGES) {
+        count = SCAN_PREFETCH_PAGES;
+    }
+    if(count > 0) {
+        prefetchRangeWithRing(rel->mgmtData, page + 1, count, ring);
+    }
+}
+
 RC next(RM_ScanHandle *scan, Record *record) {
     RM_ScanCond *scan_cond = (RM_ScanCond *) scan->mgmtData;
     Value *val = (Value*)malloc(sizeof(Value));
@@ -328,11 +372,15 @@ RC next(RM_ScanHandle *scan, Record *record) {
     pinPage(scan->rel->mgmtData, tableInfoPage, 0);
     int *integerTablePointer = (int*)tableInfoPage->data;
 
-    int totalRecordPages = integerTablePointer[2];
+    PageNumber totalRecordPages = integerTablePointer[2];
     int maxRecordsPerPage = integerTablePointer[3];
 
     unpinPage(scan->rel->mgmtData, tableInfoPage);
     free(tableInfoPage);
+    // the loop below enters every later page as it moves onto it
+    if(scan_cond->id->page == 1 && scan_cond->id->slot == 0) {
+        enterScanPage(scan->rel, scan_cond->ring, scan_cond->id->page, totalRecordPages);
+    }
     bool found = FALSE;
     while(found == FALSE) {
         if(getRecord(scan->rel, *(scan_cond->id), record) == RC_OK) {
@@ -348,6 +396,7 @@ RC next(RM_ScanHandle *scan, Record *record) {
         if (scan_cond->id->slot == maxRecordsPerPage){
             ++scan_cond->id->page;
             scan_cond->id->slot=0;
+            enterScanPage(scan->rel, scan_cond->ring, scan_cond->id->page, totalRecordPages);
         }
         else{
             ++scan_cond->id->slot;
@@ -360,6 +409,7 @@ RC next(RM_ScanHandle *scan, Record *record) {
 RC closeScan(RM_ScanHandle *scan) {
 
     RM_ScanCond *scan_cond = (RM_ScanCond *) scan->mgmtData;
+    freeScanRing(scan_cond->ring);
     free(scan_cond->id);
     free(scan_cond);
 
@@ -377,6 +427,8 @@ RC updateScan(RM_TableData *rel, Expr *cond, void (*updateFunction)(RM_TableData
     while(next(sc, record) == RC_OK) {
         updateFunction(rel, schem, record);
     }
+    closeScan(sc);
+    free(sc);
     return RC_OK;
 }
 
@@ -465,7 +517,7 @@ RC getAttr(Record *record, Schema *schema, int attrNum, Value **value) {
         typeLength = schema->typeLength[attrNum];
         tempValue->v.stringV = (char *)malloc(sizeof(char)*(typeLength+1));
         memcpy(tempValue->v.stringV, record->data + offset, typeLength);
-        tempValue->v.stringV[typeLength + 1] = '\0';
+        tempValue->v.stringV[typeLength] = '\0';
     }
     else if (schema->dataTypes[attrNum] == DT_BOOL) {
         memcpy(&(tempValue->v.boolV), record->data + offset, sizeof(bool));
@@ -4,6 +4,7 @@
 #include "dberror.h"
 #include "expr.h"
 #include "tables.h"
+#include "buffer_mgr.h"
 
 // Bookkeeping for scans
 typedef struct RM_ScanHandle
@@ -15,12 +16,14 @@ typedef struct RM_ScanHandle
 typedef struct RM_ScanCond {
     Expr *cond;
     RID *id;
+    BM_ScanRing *ring;  // frames the scan recycles instead of evicting the rest of the pool
 } RM_ScanCond;
 
 // table and manager
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager ();
 extern RC createTable (char *name, Schema *schema);
+extern RC createTableWithPageSize (char *name, Schema *schema, int pageSize);
 extern RC openTable (RM_TableData *rel, char *name);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
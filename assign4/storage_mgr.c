@@ -1,91 +1,501 @@
+#define _GNU_SOURCE
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<stdint.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/types.h>
+#include<sys/uio.h>
+#include<sys/syscall.h>
+#include<limits.h>
+#include<pthread.h>
+#include<linux/io_uring.h>
 
 #include "dberror.h"
+#include "dt.h"
 #include "storage_mgr.h"
 
-FILE* filePtr;
+// bookkeeping kept behind fHandle->mgmtInfo for an open page file
+typedef struct SM_FileMgmt {
+    int fd;
+    // read with ioModeOf: async workers may see dropDirectIO switch it under them
+    SM_IOMode mode;
+    // serialises dropDirectIO
+    pthread_mutex_t modeLock;
+    // transfers hold it shared from their bounds check to the end of the copy, growFile holds it
+    // exclusively while totalNumPages and the mapping change, so I/O on one handle can run on
+    // several threads at once
+    pthread_rwlock_t sizeLock;
+    // bytes per page and where page 0 starts (just past the file header)
+    int pageSize;
+    off_t dataOffset;
+    // SM_IO_MMAP only: mapping of the whole file and its length in bytes
+    char *map;
+    size_t mapSize;
+    // disk space reserved past EOF (in pages) and how far to reserve ahead when growing
+    PageNumber reservedPages;
+    int growthChunkPages;
+    int growthPercent;
+    bool canReserve;
+} SM_FileMgmt;
+
+// written at the start of every page file; the rest of the header block is zero
+typedef struct SM_FileHeader {
+    char magic[8];
+    int32_t pageSize;
+} SM_FileHeader;
+
+static const char SM_FILE_MAGIC[8] = "SMPAGEF";
+
+// page sizes must be a power of two so pages stay aligned for O_DIRECT
+static bool isValidPageSize(int pageSize) {
+    return pageSize >= SM_MIN_PAGE_SIZE && pageSize <= SM_MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
+// byte position of a page in the file
+static off_t pageOffset(SM_FileMgmt *mgmt, PageNumber pageNum) {
+    return mgmt->dataOffset + (off_t)pageNum * mgmt->pageSize;
+}
+
+// true if the buffer can be handed to an O_DIRECT descriptor as is
+static bool isAligned(const void *memPage) {
+    return ((uintptr_t)memPage % SM_IO_ALIGNMENT) == 0;
+}
+
+static SM_IOMode ioModeOf(SM_FileMgmt *mgmt) {
+    return __atomic_load_n(&mgmt->mode, __ATOMIC_ACQUIRE);
+}
+
+// turns O_DIRECT off for a descriptor whose filesystem rejected direct transfers; several
+// async workers can hit the same EINVAL, so only the first one switches the descriptor
+static void dropDirectIO(SM_FileMgmt *mgmt) {
+    pthread_mutex_lock(&mgmt->modeLock);
+    if(ioModeOf(mgmt) == SM_IO_DIRECT) {
+        int flags = fcntl(mgmt->fd, F_GETFL);
+        if(flags != -1) {
+            fcntl(mgmt->fd, F_SETFL, flags & ~O_DIRECT);
+        }
+        __atomic_store_n(&mgmt->mode, SM_IO_PREAD, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&mgmt->modeLock);
+}
+
+// reads or writes exactly one page (mgmt->pageSize bytes) at off_set, retrying on short transfers
+static RC transferPage(SM_FileMgmt *mgmt, SM_PageHandle memPage, off_t off_set, bool isWrite) {
+    if(ioModeOf(mgmt) == SM_IO_MMAP) {
+        if((size_t)off_set + mgmt->pageSize > mgmt->mapSize) {
+            return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        }
+        if(isWrite) {
+            memcpy(mgmt->map + off_set, memPage, mgmt->pageSize);
+        }
+        else {
+            memcpy(memPage, mgmt->map + off_set, mgmt->pageSize);
+        }
+        return RC_OK;
+    }
+
+    // O_DIRECT needs an aligned buffer; callers that pass a plain malloc'd page go through a bounce buffer
+    if(ioModeOf(mgmt) == SM_IO_DIRECT && !isAligned(memPage)) {
+        SM_PageHandle bounce;
+        if(posix_memalign((void **)&bounce, SM_IO_ALIGNMENT, mgmt->pageSize) != 0) {
+            return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        }
+        if(isWrite) {
+            memcpy(bounce, memPage, mgmt->pageSize);
+        }
+        RC rc = transferPage(mgmt, bounce, off_set, isWrite);
+        if(rc == RC_OK && !isWrite) {
+            memcpy(memPage, bounce, mgmt->pageSize);
+        }
+        free(bounce);
+        return rc;
+    }
+
+    int fd = mgmt->fd;
+    size_t done = 0;
+    while(done < mgmt->pageSize) {
+        ssize_t n = isWrite ? pwrite(fd, memPage + done, mgmt->pageSize - done, off_set + done)
+                            : pread(fd, memPage + done, mgmt->pageSize - done, off_set + done);
+        if(n < 0 && errno == EINVAL && ioModeOf(mgmt) == SM_IO_DIRECT) {
+            dropDirectIO(mgmt);
+            continue;
+        }
+        if(n <= 0) {
+            return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        }
+        done += n;
+    }
+    return RC_OK;
+}
+
+// moves count consecutive pages starting at off_set with one preadv/pwritev per IOV_MAX pages
+static RC transferRun(SM_FileMgmt *mgmt, SM_PageHandle *memPages, int count, off_t off_set, bool isWrite) {
+    bool perPage = (ioModeOf(mgmt) == SM_IO_MMAP);
+    for(int i = 0; !perPage && ioModeOf(mgmt) == SM_IO_DIRECT && i < count; i++) {
+        perPage = !isAligned(memPages[i]);
+    }
+    if(perPage) {
+        for(int i = 0; i < count; i++) {
+            RC rc = transferPage(mgmt, memPages[i], off_set + (off_t)i * mgmt->pageSize, isWrite);
+            if(rc != RC_OK) {
+                return rc;
+            }
+        }
+        return RC_OK;
+    }
+
+    struct iovec iov[IOV_MAX];
+    int first = 0;
+    while(first < count) {
+        int n = (count - first < IOV_MAX) ? count - first : IOV_MAX;
+        for(int i = 0; i < n; i++) {
+            iov[i].iov_base = memPages[first + i];
+            iov[i].iov_len = mgmt->pageSize;
+        }
+
+        // keep going until the whole batch is transferred; a short transfer resumes mid-iovec
+        struct iovec *cur = iov;
+        int curCnt = n;
+        off_t pos = off_set + (off_t)first * mgmt->pageSize;
+        while(curCnt > 0) {
+            ssize_t done = isWrite ? pwritev(mgmt->fd, cur, curCnt, pos)
+                                   : preadv(mgmt->fd, cur, curCnt, pos);
+            if(done < 0 && errno == EINVAL && ioModeOf(mgmt) == SM_IO_DIRECT) {
+                dropDirectIO(mgmt);
+                continue;
+            }
+            if(done <= 0) {
+                return isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+            }
+            pos += done;
+            while(curCnt > 0 && (size_t)done >= cur->iov_len) {
+                done -= cur->iov_len;
+                cur++;
+                curCnt--;
+            }
+            if(curCnt > 0) {
+                cur->iov_base = (char *)cur->iov_base + done;
+                cur->iov_len -= done;
+            }
+        }
+        first += n;
+    }
+    return RC_OK;
+}
+
+// curPagePos is only a cursor for the sequential read calls; threads sharing a handle each
+// update it with a single store, the last transfer to finish wins
+static void setPagePos(SM_FileHandle *fHandle, PageNumber pageNum) {
+    __atomic_store_n(&fHandle->curPagePos, pageNum, __ATOMIC_RELAXED);
+}
+
+// transfers an arbitrary list of pages, merging runs of consecutive page numbers into one vectored call
+static RC transferList(SM_FileHandle *fHandle, PageNumber *pageNums, int count, SM_PageHandle *memPages, bool isWrite) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if(mgmt == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    pthread_rwlock_rdlock(&mgmt->sizeLock);
+    RC rc = RC_OK;
+    for(int i = 0; i < count && rc == RC_OK; i++) {
+        if(pageNums[i] < 0 || pageNums[i] >= fHandle->totalNumPages) {
+            rc = isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        }
+    }
+
+    int runStart = 0;
+    while(rc == RC_OK && runStart < count) {
+        int runEnd = runStart + 1;
+        while(runEnd < count && pageNums[runEnd] == pageNums[runEnd - 1] + 1) {
+            runEnd++;
+        }
+        rc = transferRun(mgmt, memPages + runStart, runEnd - runStart, pageOffset(mgmt, pageNums[runStart]), isWrite);
+        runStart = runEnd;
+    }
+    pthread_rwlock_unlock(&mgmt->sizeLock);
+
+    if(rc == RC_OK && count > 0) {
+        setPagePos(fHandle, pageNums[count - 1]);
+    }
+    return rc;
+}
 
 void initStorageManager(void) {
-    filePtr = NULL;
+    // nothing to set up; every open page file carries its own descriptor
 }
 
 RC createPageFile(char *fileName) {
+    return createPageFileWithSize(fileName, PAGE_SIZE);
+}
+
+RC createPageFileWithSize(char *fileName, int pageSize) {
+
+    if(!isValidPageSize(pageSize)) {
+        return RC_INVALID_PAGE_SIZE;
+    }
 
     // Create a new file and open it for update(read & write)
     // If a file exists with the same name, discard its contents and create a new file
-    filePtr = fopen(fileName, "wb+");
+    int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
 
     // If could not create a new file, return error code
-    if(filePtr == NULL) {
+    if(fd < 0) {
         return RC_FILE_NOT_FOUND;
     }
 
-    // Allocate memory for a page
-    SM_PageHandle* page = (SM_PageHandle*)calloc(PAGE_SIZE, sizeof(char));
+    // Allocate memory for a page; it is large enough for the header block as well
+    SM_PageHandle page = (SM_PageHandle)calloc(pageSize, sizeof(char));
 
-    // Write page to the file
-    int status = fwrite(page, PAGE_SIZE, 1, filePtr);
+    // Write the header block recording the page size, then the first empty page
+    SM_FileHeader header;
+    memcpy(header.magic, SM_FILE_MAGIC, sizeof(header.magic));
+    header.pageSize = pageSize;
+    memcpy(page, &header, sizeof(header));
+
+    SM_FileMgmt tmp = { .fd = fd, .mode = SM_IO_PREAD, .pageSize = SM_FILE_HEADER_SIZE, .dataOffset = 0 };
+    RC rc = transferPage(&tmp, page, 0, TRUE);
+    if(rc == RC_OK) {
+        memset(page, 0, sizeof(header));
+        tmp.pageSize = pageSize;
+        rc = transferPage(&tmp, page, SM_FILE_HEADER_SIZE, TRUE);
+    }
 
     // Free the allocated memory
     free(page);
 
-    // If return value < number of elements(1), return write error code
-    if(status < 1) {
+    // Return error code if file wasn't closed successfully
+    if(close(fd) != 0 && rc == RC_OK) {
+        rc = RC_FILE_CLOSE_FAILED;
+    }
+
+    return rc;
+}
+
+// grows or shrinks a mapped file to numPages pages and moves the mapping along with it
+static RC resizeMappedFile(SM_FileMgmt *mgmt, PageNumber numPages) {
+    size_t newSize = (size_t)pageOffset(mgmt, numPages);
+
+    if(ftruncate(mgmt->fd, newSize) != 0) {
+        return RC_WRITE_FAILED;
+    }
+
+    char *newMap;
+    if(mgmt->map == NULL) {
+        newMap = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, mgmt->fd, 0);
+    }
+    else {
+        newMap = mremap(mgmt->map, mgmt->mapSize, newSize, MREMAP_MAYMOVE);
+    }
+    if(newMap == MAP_FAILED) {
         return RC_WRITE_FAILED;
     }
 
-    status = fclose(filePtr);
+    mgmt->map = newMap;
+    mgmt->mapSize = newSize;
+    return RC_OK;
+}
 
-    // Return error code if file wasn't closed successfully
-    if(status != 0) {
-        return RC_FILE_CLOSE_FAILED;
+// reserves disk blocks for at least numberOfPages without changing the file size,
+// rounding up to the growth chunk so a run of appends hits the allocator only once per chunk
+static void reserveSpace(SM_FileMgmt *mgmt, PageNumber totalNumPages, PageNumber numberOfPages) {
+    if(!mgmt->canReserve || numberOfPages <= mgmt->reservedPages) {
+        return;
     }
 
+    PageNumber target = totalNumPages + mgmt->growthChunkPages;
+    PageNumber geometric = totalNumPages + totalNumPages * mgmt->growthPercent / 100;
+    if(geometric > target) {
+        target = geometric;
+    }
+    if(numberOfPages > target) {
+        target = numberOfPages;
+    }
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    if(fallocate(mgmt->fd, FALLOC_FL_KEEP_SIZE, 0, pageOffset(mgmt, target)) == 0) {
+        mgmt->reservedPages = target;
+        return;
+    }
+#endif
+    // the filesystem cannot preallocate; stop asking and let ftruncate do all the work
+    mgmt->canReserve = FALSE;
+}
+
+// grows the file by addPages pages, or to minPages if that is more, with one ftruncate (plus a
+// remap in mmap mode); the size is read under sizeLock so concurrent growers do not lose pages
+static RC growFile(SM_FileHandle *fHandle, PageNumber minPages, PageNumber addPages) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if(mgmt == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    pthread_rwlock_wrlock(&mgmt->sizeLock);
+    PageNumber numberOfPages = fHandle->totalNumPages + addPages;
+    if(numberOfPages < minPages) {
+        numberOfPages = minPages;
+    }
+    if(numberOfPages == fHandle->totalNumPages) {
+        pthread_rwlock_unlock(&mgmt->sizeLock);
+        return RC_OK;
+    }
+
+    reserveSpace(mgmt, fHandle->totalNumPages, numberOfPages);
+
+    RC rc = RC_OK;
+    if(mgmt->mode == SM_IO_MMAP) {
+        rc = resizeMappedFile(mgmt, numberOfPages);
+    }
+    else if(ftruncate(mgmt->fd, pageOffset(mgmt, numberOfPages)) != 0) {
+        rc = RC_WRITE_FAILED;
+    }
+    if(rc == RC_OK) {
+        //update page number; new pages read back as zeroes
+        fHandle->totalNumPages = numberOfPages;
+        setPagePos(fHandle, numberOfPages);
+    }
+    pthread_rwlock_unlock(&mgmt->sizeLock);
+    return rc;
+}
+
+// fills in pageSize and dataOffset from the header block at the start of the file
+static RC readFileHeader(SM_FileMgmt *mgmt) {
+    SM_PageHandle block;
+    if(posix_memalign((void **)&block, SM_IO_ALIGNMENT, SM_FILE_HEADER_SIZE) != 0) {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    SM_FileHeader header;
+    mgmt->pageSize = SM_FILE_HEADER_SIZE;
+    mgmt->dataOffset = 0;
+    RC rc = transferPage(mgmt, block, 0, FALSE);
+    memcpy(&header, block, sizeof(header));
+    free(block);
+
+    if(rc != RC_OK || memcmp(header.magic, SM_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        mgmt->pageSize = PAGE_SIZE;
+        return RC_OK;
+    }
+    if(!isValidPageSize(header.pageSize)) {
+        return RC_INVALID_PAGE_SIZE;
+    }
+    mgmt->pageSize = header.pageSize;
+    mgmt->dataOffset = SM_FILE_HEADER_SIZE;
     return RC_OK;
 }
 
 RC openPageFile(char *fileName, SM_FileHandle *fHandle) {
+    return openPageFileMode(fileName, fHandle, SM_IO_PREAD);
+}
+
+RC openPageFileMode(char *fileName, SM_FileHandle *fHandle, SM_IOMode mode) {
 
     // Open a file for update(read & write), the file must exist
-    filePtr = fopen(fileName, "r+");
+    // The descriptor stays open until closePageFile, so callers such as the buffer pool
+    // can keep one handle around instead of reopening the file for every page
+    int fd;
+    if(mode == SM_IO_DIRECT) {
+        // bypass the kernel page cache; filesystems such as tmpfs refuse O_DIRECT,
+        // in which case the file is opened for regular buffered I/O instead
+        fd = open(fileName, O_RDWR | O_DIRECT);
+        if(fd < 0 && errno == EINVAL) {
+            mode = SM_IO_PREAD;
+            fd = open(fileName, O_RDWR);
+        }
+    }
+    else {
+        fd = open(fileName, O_RDWR);
+    }
 
     // Check if the file was opened successfully
-    if(filePtr == NULL) {
+    if(fd < 0) {
         return RC_FILE_NOT_FOUND;
     }
 
-    // Go to the end of the file and get the position to calculate fileSize
-    int status = fseek(filePtr, 0, SEEK_END);
-
-    // Return error code if if seek was unsuccessful
-    if(status != 0) {
+    // Get fileSize
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
         return RC_FILE_SEEK_ERROR;
     }
 
-    // Get fileSize
-    int fileSize = ftell(filePtr);
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)malloc(sizeof(SM_FileMgmt));
+    mgmt->fd = fd;
+    mgmt->mode = (mode == SM_IO_MMAP) ? SM_IO_PREAD : mode;
+    mgmt->map = NULL;
+    mgmt->mapSize = 0;
+    pthread_mutex_init(&mgmt->modeLock, NULL);
+    pthread_rwlock_init(&mgmt->sizeLock, NULL);
 
-    // Move the file pointer back to the start
-    status = fseek(filePtr, 0, SEEK_SET);
+    // the header block tells the page size; a file without one predates page size
+    // headers and holds headerless PAGE_SIZE pages
+    RC rc = readFileHeader(mgmt);
+    if(rc != RC_OK) {
+        pthread_mutex_destroy(&mgmt->modeLock);
+        pthread_rwlock_destroy(&mgmt->sizeLock);
+        free(mgmt);
+        close(fd);
+        return rc;
+    }
+    if(mode == SM_IO_MMAP) {
+        mgmt->mode = SM_IO_MMAP;
+    }
 
-    // Return error code if if seek was unsuccessful
-    if(status != 0) {
-        return RC_FILE_SEEK_ERROR;
+    mgmt->reservedPages = (st.st_size - mgmt->dataOffset)/mgmt->pageSize;
+    mgmt->growthChunkPages = SM_DEFAULT_GROWTH_CHUNK;
+    mgmt->growthPercent = 0;
+    mgmt->canReserve = TRUE;
+
+    // map the whole file up front; readBlock and writeBlock then become plain memcpys
+    if(mode == SM_IO_MMAP && st.st_size > 0) {
+        mgmt->map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(mgmt->map == MAP_FAILED) {
+            pthread_mutex_destroy(&mgmt->modeLock);
+            pthread_rwlock_destroy(&mgmt->sizeLock);
+            free(mgmt);
+            close(fd);
+            return RC_FILE_NOT_FOUND;
+        }
+        mgmt->mapSize = st.st_size;
     }
 
     fHandle->fileName = fileName;
     fHandle->curPagePos = 0;
-    fHandle->totalNumPages = fileSize/PAGE_SIZE;
-    fHandle->mgmtInfo = filePtr;
+    fHandle->totalNumPages = (st.st_size - mgmt->dataOffset)/mgmt->pageSize;
+    fHandle->pageSize = mgmt->pageSize;
+    fHandle->mgmtInfo = mgmt;
 
     return RC_OK;
 }
 
+// the mode the file actually ended up with; SM_IO_DIRECT may have fallen back to SM_IO_PREAD
+SM_IOMode getIOMode(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    return mgmt == NULL ? SM_IO_PREAD : ioModeOf(mgmt);
+}
+
 RC closePageFile(SM_FileHandle *fHandle) {
 
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if(mgmt == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    if(mgmt->map != NULL) {
+        munmap(mgmt->map, mgmt->mapSize);
+    }
+
     // Close the file
-    int status = fclose(fHandle->mgmtInfo);
+    int status = close(mgmt->fd);
+    pthread_mutex_destroy(&mgmt->modeLock);
+    pthread_rwlock_destroy(&mgmt->sizeLock);
+    free(mgmt);
+    fHandle->mgmtInfo = NULL;
 
     // Return error code if file wasn't closed successfully
     if(status != 0) {
@@ -107,38 +517,36 @@ RC destroyPageFile(char *fileName) {
 }
 
 // To read a page number as requested by the client
-RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+RC readBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if(mgmt == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
 
     // Check if the requested page number is greater than total no. of pages or is an invalid input(smaller than 0)
+    pthread_rwlock_rdlock(&mgmt->sizeLock);
     if (fHandle->totalNumPages < (pageNum + 1) || pageNum < 0) {
-		return RC_READ_NON_EXISTING_PAGE;
-	}
-
-	// Get the off_set from the starting point
-	int off_set = sizeof(char) * pageNum * PAGE_SIZE;
-
-	// To check if the pointer is set correctly
-	int check = fseek(fHandle->mgmtInfo, off_set, SEEK_SET);
-
-	if (check != 0) {
-		return RC_FILE_SEEK_ERROR;
-	}
+        pthread_rwlock_unlock(&mgmt->sizeLock);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
 
-	// To check if read succesfully or not
-	int read = fread(memPage, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
-	if (read != PAGE_SIZE) {
-		return RC_READ_NON_EXISTING_PAGE;
-	}
+    // pread takes the offset explicitly, so there is no shared seek position to move
+    RC rc = transferPage(mgmt, memPage, pageOffset(mgmt, pageNum), FALSE);
+    pthread_rwlock_unlock(&mgmt->sizeLock);
+    if(rc != RC_OK) {
+        return rc;
+    }
 
-	// Changing the current page number to the input page number
-	fHandle->curPagePos = pageNum;
+    // Changing the current page number to the input page number
+    setPagePos(fHandle, pageNum);
 
-	return RC_OK;
+    return RC_OK;
 }
 
 // Getting the current page number
-int getBlockPos(SM_FileHandle *fHandle) {
-    return fHandle->curPagePos;
+PageNumber getBlockPos(SM_FileHandle *fHandle) {
+    return __atomic_load_n(&fHandle->curPagePos, __ATOMIC_RELAXED);
 }
 
 // Reading the first page of the block. This is done by calling readBlock function and passing 0 as page number for 1st page
@@ -148,17 +556,17 @@ RC readFirstBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
 
 // Reading the first page of the block. This is done by calling readBlock function and passing current Page - 1 as page number
 RC readPreviousBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    return readBlock(fHandle->curPagePos - 1, fHandle, memPage);
+    return readBlock(getBlockPos(fHandle) - 1, fHandle, memPage);
 }
 
 // Reading the first page of the block. This is done by calling readBlock function and passing current page number
 RC readCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    return readBlock(fHandle->curPagePos, fHandle, memPage);
+    return readBlock(getBlockPos(fHandle), fHandle, memPage);
 }
 
 // Reading the first page of the block. This is done by calling readBlock function and passing current Page + 1 as page number
 RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    return readBlock(fHandle->curPagePos + 1, fHandle, memPage);
+    return readBlock(getBlockPos(fHandle) + 1, fHandle, memPage);
 }
 
 // Reading the first page of the block. This is done by calling readBlock function and passing total no. of pages -1 as page number
@@ -166,23 +574,26 @@ RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
     return readBlock(fHandle->totalNumPages - 1, fHandle, memPage);
 }
 
-RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+RC writeBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if(mgmt == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
     //if the page number is not right, i.e. pageNum < 0 || pageNum >= total, return failed.
+    pthread_rwlock_rdlock(&mgmt->sizeLock);
     if (pageNum < 0 || fHandle->totalNumPages < (pageNum + 1)) {
+        pthread_rwlock_unlock(&mgmt->sizeLock);
         return RC_WRITE_FAILED;
     }
 
-    //find the correct position
-    int pos = pageNum * PAGE_SIZE * sizeof(char);
-    int seekSuccess = fseek(fHandle->mgmtInfo, pos, SEEK_SET);
-
-    //if seekSuccess != 0, cannot write, return failed.
-    if(seekSuccess != 0){
-        return RC_WRITE_FAILED;
+    //write at the page's position without touching a file pointer
+    RC rc = transferPage(mgmt, memPage, pageOffset(mgmt, pageNum), TRUE);
+    pthread_rwlock_unlock(&mgmt->sizeLock);
+    if(rc != RC_OK) {
+        return rc;
     }
-
-    fwrite(memPage, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
-    fHandle->curPagePos = pageNum;
+    setPagePos(fHandle, pageNum);
 
     return RC_OK;
 
@@ -190,40 +601,554 @@ RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
 
 //write in current position
 RC writeCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    return writeBlock (fHandle->curPagePos, fHandle, memPage);
+    return writeBlock (getBlockPos(fHandle), fHandle, memPage);
+}
+
+// reads count consecutive pages starting at startPage into memPages[0..count-1]
+RC readBlocks(PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if(mgmt == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    pthread_rwlock_rdlock(&mgmt->sizeLock);
+    if(startPage < 0 || count < 0 || fHandle->totalNumPages < startPage + count) {
+        pthread_rwlock_unlock(&mgmt->sizeLock);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    RC rc = transferRun(mgmt, memPages, count, pageOffset(mgmt, startPage), FALSE);
+    pthread_rwlock_unlock(&mgmt->sizeLock);
+    if(rc == RC_OK && count > 0) {
+        setPagePos(fHandle, startPage + count - 1);
+    }
+    return rc;
+}
+
+// writes memPages[0..count-1] to count consecutive pages starting at startPage
+RC writeBlocks(PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if(mgmt == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    pthread_rwlock_rdlock(&mgmt->sizeLock);
+    if(startPage < 0 || count < 0 || fHandle->totalNumPages < startPage + count) {
+        pthread_rwlock_unlock(&mgmt->sizeLock);
+        return RC_WRITE_FAILED;
+    }
+
+    RC rc = transferRun(mgmt, memPages, count, pageOffset(mgmt, startPage), TRUE);
+    pthread_rwlock_unlock(&mgmt->sizeLock);
+    if(rc == RC_OK && count > 0) {
+        setPagePos(fHandle, startPage + count - 1);
+    }
+    return rc;
+}
+
+// scatter read: page pageNums[i] goes into memPages[i]
+RC readBlockList(PageNumber *pageNums, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    return transferList(fHandle, pageNums, count, memPages, FALSE);
+}
+
+// gather write: memPages[i] goes to page pageNums[i]
+RC writeBlockList(PageNumber *pageNums, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+    return transferList(fHandle, pageNums, count, memPages, TRUE);
 }
 
 RC appendEmptyBlock(SM_FileHandle *fHandle) {
-    //move to the end of the file
-    int seekSuccess = fseek(fHandle->mgmtInfo, 0, SEEK_END);
+    return growFile(fHandle, 0, 1);
+}
+
+RC ensureCapacity(PageNumber numberOfPages, SM_FileHandle *fHandle) {
+    //one truncate covers the whole gap instead of appending page by page; a file that is
+    //already large enough is left alone
+    return growFile(fHandle, numberOfPages, 0);
+}
+
+// configures how far ahead of the file size disk space is reserved when the file grows:
+// at least chunkPages pages, or growthPercent of the current size if that is larger
+RC setGrowthPolicy(SM_FileHandle *fHandle, int chunkPages, int growthPercent) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if(mgmt == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    mgmt->growthChunkPages = chunkPages < 1 ? 1 : chunkPages;
+    mgmt->growthPercent = growthPercent < 0 ? 0 : growthPercent;
+    return RC_OK;
+}
 
-    if(seekSuccess != 0){
+// makes the pages written so far durable; in SM_IO_MMAP mode the mapping is flushed first
+RC syncPageFile(SM_FileHandle *fHandle) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)fHandle->mgmtInfo;
+    if(mgmt == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if(mgmt->map != NULL && msync(mgmt->map, mgmt->mapSize, MS_SYNC) != 0) {
         return RC_WRITE_FAILED;
     }
+    return fdatasync(mgmt->fd) == 0 ? RC_OK : RC_WRITE_FAILED;
+}
+
+/************************************************************
+ *                    asynchronous I/O                      *
+ ************************************************************/
+
+// an engine is driven by one thread at a time (see storage_mgr.h): only the done and work lists,
+// which the thread pool's workers share, are guarded by lock
+struct SM_AsyncIO {
+    SM_AsyncBackend backend;
+    // requests handed to queueAsyncIO that waitAsyncIO has not returned yet
+    int outstanding;
+    // queued but not submitted yet
+    SM_AsyncRequest *batchHead;
+    SM_AsyncRequest *batchTail;
+    int batchCount;
+    // finished and waiting to be returned by waitAsyncIO
+    SM_AsyncRequest *doneHead;
+    SM_AsyncRequest *doneTail;
+    int doneCount;
+    pthread_mutex_t lock;
+    pthread_cond_t doneCond;
+
+    // thread pool backend
+    pthread_cond_t workCond;
+    SM_AsyncRequest *workHead;
+    SM_AsyncRequest *workTail;
+    pthread_t workers[SM_AIO_WORKERS];
+    int numWorkers;
+    bool stopping;
+
+    // io_uring backend
+    int ringFd;
+    void *sqRing;
+    void *cqRing;
+    size_t sqRingSize;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+    unsigned sqEntries;
+    unsigned cqEntries;
+    // submitted to the kernel and not reaped yet
+    int inRing;
+};
+
+static void appendRequest(SM_AsyncRequest **head, SM_AsyncRequest **tail, SM_AsyncRequest *req) {
+    req->next = NULL;
+    if(*tail == NULL) {
+        *head = req;
+    }
+    else {
+        (*tail)->next = req;
+    }
+    *tail = req;
+}
+
+static SM_AsyncRequest *popRequest(SM_AsyncRequest **head, SM_AsyncRequest **tail) {
+    SM_AsyncRequest *req = *head;
+    if(req != NULL) {
+        *head = req->next;
+        if(*head == NULL) {
+            *tail = NULL;
+        }
+        req->next = NULL;
+    }
+    return req;
+}
+
+// hands a finished request to the done list; lock must be held
+static void pushDone(SM_AsyncIO *aio, SM_AsyncRequest *req) {
+    appendRequest(&aio->doneHead, &aio->doneTail, req);
+    aio->doneCount++;
+    pthread_cond_signal(&aio->doneCond);
+}
+
+// same bounds checks readBlock/writeBlock apply
+static RC checkRequest(SM_AsyncRequest *req) {
+    if(req->fHandle == NULL || req->fHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)req->fHandle->mgmtInfo;
+    pthread_rwlock_rdlock(&mgmt->sizeLock);
+    bool inFile = req->pageNum >= 0 && req->pageNum < req->fHandle->totalNumPages;
+    pthread_rwlock_unlock(&mgmt->sizeLock);
+    if(!inFile) {
+        return req->isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+    }
+    return RC_OK;
+}
+
+// executes a request synchronously on the calling thread
+static RC runRequest(SM_AsyncRequest *req) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)req->fHandle->mgmtInfo;
+    pthread_rwlock_rdlock(&mgmt->sizeLock);
+    RC rc = transferPage(mgmt, req->memPage, pageOffset(mgmt, req->pageNum), req->isWrite);
+    pthread_rwlock_unlock(&mgmt->sizeLock);
+    return rc;
+}
+
+static void *asyncWorker(void *arg) {
+    SM_AsyncIO *aio = (SM_AsyncIO *)arg;
+
+    pthread_mutex_lock(&aio->lock);
+    while(1) {
+        while(!aio->stopping && aio->workHead == NULL) {
+            pthread_cond_wait(&aio->workCond, &aio->lock);
+        }
+        SM_AsyncRequest *req = popRequest(&aio->workHead, &aio->workTail);
+        if(req == NULL) {
+            break;
+        }
+        pthread_mutex_unlock(&aio->lock);
+
+        req->rc = runRequest(req);
+
+        pthread_mutex_lock(&aio->lock);
+        pushDone(aio, req);
+    }
+    pthread_mutex_unlock(&aio->lock);
+    return NULL;
+}
+
+static int ringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+// creates the submission/completion rings; fails if the kernel lacks io_uring or forbids it
+static RC setupRing(SM_AsyncIO *aio, int queueDepth) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int ringFd = (int)syscall(__NR_io_uring_setup, queueDepth, &params);
+    if(ringFd < 0) {
+        return RC_ASYNC_IO_UNAVAILABLE;
+    }
+
+    aio->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    aio->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(singleMmap) {
+        if(aio->cqRingSize > aio->sqRingSize) {
+            aio->sqRingSize = aio->cqRingSize;
+        }
+        aio->cqRingSize = aio->sqRingSize;
+    }
+
+    aio->sqRing = mmap(NULL, aio->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if(aio->sqRing == MAP_FAILED) {
+        close(ringFd);
+        return RC_ASYNC_IO_UNAVAILABLE;
+    }
+    aio->cqRing = singleMmap ? aio->sqRing
+                             : mmap(NULL, aio->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    aio->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if(aio->cqRing == MAP_FAILED || aio->sqes == MAP_FAILED) {
+        if(aio->sqes != MAP_FAILED) {
+            munmap(aio->sqes, params.sq_entries * sizeof(struct io_uring_sqe));
+        }
+        if(!singleMmap && aio->cqRing != MAP_FAILED) {
+            munmap(aio->cqRing, aio->cqRingSize);
+        }
+        munmap(aio->sqRing, aio->sqRingSize);
+        close(ringFd);
+        return RC_ASYNC_IO_UNAVAILABLE;
+    }
+
+    char *sq = (char *)aio->sqRing;
+    char *cq = (char *)aio->cqRing;
+    aio->sqHead = (unsigned *)(sq + params.sq_off.head);
+    aio->sqTail = (unsigned *)(sq + params.sq_off.tail);
+    aio->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+    aio->sqArray = (unsigned *)(sq + params.sq_off.array);
+    aio->cqHead = (unsigned *)(cq + params.cq_off.head);
+    aio->cqTail = (unsigned *)(cq + params.cq_off.tail);
+    aio->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+    aio->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    aio->sqEntries = params.sq_entries;
+    aio->cqEntries = params.cq_entries;
+    aio->ringFd = ringFd;
+    aio->inRing = 0;
+    return RC_OK;
+}
+
+static void teardownRing(SM_AsyncIO *aio) {
+    munmap(aio->sqes, aio->sqEntries * sizeof(struct io_uring_sqe));
+    if(aio->cqRing != aio->sqRing) {
+        munmap(aio->cqRing, aio->cqRingSize);
+    }
+    munmap(aio->sqRing, aio->sqRingSize);
+    close(aio->ringFd);
+}
+
+// turns a completion queue entry into a request result
+static void finishRingRequest(SM_AsyncIO *aio, SM_AsyncRequest *req, int res) {
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)req->fHandle->mgmtInfo;
+
+    if(res == mgmt->pageSize) {
+        req->rc = RC_OK;
+    }
+    else if(res == -EINVAL && ioModeOf(mgmt) == SM_IO_DIRECT) {
+        // the filesystem refused O_DIRECT after all; redo it buffered
+        dropDirectIO(mgmt);
+        req->rc = runRequest(req);
+    }
+    else if(res >= 0) {
+        // short transfer; redo the whole page synchronously
+        req->rc = runRequest(req);
+    }
+    else {
+        req->rc = req->isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+    }
+
+    pthread_mutex_lock(&aio->lock);
+    pushDone(aio, req);
+    pthread_mutex_unlock(&aio->lock);
+}
+
+// moves whatever the kernel has completed to the done list, blocking for at least minWait completions
+static void reapRing(SM_AsyncIO *aio, int minWait) {
+    if(minWait > aio->inRing) {
+        minWait = aio->inRing;
+    }
+
+    unsigned head = *aio->cqHead;
+    if(minWait > 0 && head == __atomic_load_n(aio->cqTail, __ATOMIC_ACQUIRE)) {
+        ringEnter(aio->ringFd, 0, minWait, IORING_ENTER_GETEVENTS);
+    }
+
+    unsigned tail = __atomic_load_n(aio->cqTail, __ATOMIC_ACQUIRE);
+    while(head != tail) {
+        struct io_uring_cqe *cqe = &aio->cqes[head & *aio->cqMask];
+        SM_AsyncRequest *req = (SM_AsyncRequest *)(uintptr_t)cqe->user_data;
+        int res = cqe->res;
+        head++;
+        __atomic_store_n(aio->cqHead, head, __ATOMIC_RELEASE);
+        aio->inRing--;
+        finishRingRequest(aio, req, res);
+    }
+}
+
+// writes a submission queue entry; nothing reaches the kernel until submitAsyncIO
+static void queueRing(SM_AsyncIO *aio, SM_AsyncRequest *req) {
+    unsigned tail = *aio->sqTail;
+    unsigned idx = tail & *aio->sqMask;
+    struct io_uring_sqe *sqe = &aio->sqes[idx];
+    SM_FileMgmt *mgmt = (SM_FileMgmt *)req->fHandle->mgmtInfo;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = req->isWrite ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = mgmt->fd;
+    sqe->addr = (uintptr_t)req->memPage;
+    sqe->len = mgmt->pageSize;
+    sqe->off = pageOffset(mgmt, req->pageNum);
+    sqe->user_data = (uintptr_t)req;
+
+    aio->sqArray[idx] = idx;
+    __atomic_store_n(aio->sqTail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// the kernel refused the submission queue: take back the entries it has not consumed and
+// complete their requests with an error so nobody waits for them
+static void failUnsubmitted(SM_AsyncIO *aio) {
+    unsigned tail = *aio->sqTail;
+    for(int k = 0; k < aio->batchCount; k++) {
+        tail--;
+        struct io_uring_sqe *sqe = &aio->sqes[aio->sqArray[tail & *aio->sqMask]];
+        SM_AsyncRequest *req = (SM_AsyncRequest *)(uintptr_t)sqe->user_data;
+        req->rc = req->isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        pthread_mutex_lock(&aio->lock);
+        pushDone(aio, req);
+        pthread_mutex_unlock(&aio->lock);
+    }
+    __atomic_store_n(aio->sqTail, tail, __ATOMIC_RELEASE);
+    aio->batchCount = 0;
+}
+
+// starts an asynchronous I/O engine that can have up to queueDepth requests in flight
+// releases an engine whose ring and workers are already gone
+static void freeEngine(SM_AsyncIO *engine) {
+    pthread_mutex_destroy(&engine->lock);
+    pthread_cond_destroy(&engine->doneCond);
+    pthread_cond_destroy(&engine->workCond);
+    free(engine);
+}
+
+RC initAsyncIO(SM_AsyncIO **aio, int queueDepth, SM_AsyncBackend backend) {
+    SM_AsyncIO *engine = (SM_AsyncIO *)calloc(1, sizeof(SM_AsyncIO));
+    if(queueDepth <= 0) {
+        queueDepth = 64;
+    }
 
-    //write into file
-    SM_PageHandle newPage = (char *) calloc(PAGE_SIZE, sizeof(char));
-    fwrite(newPage, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
-    //update page number
-    fHandle->totalNumPages = fHandle->totalNumPages + 1;
-    fHandle->curPagePos = fHandle->totalNumPages;
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->doneCond, NULL);
+    pthread_cond_init(&engine->workCond, NULL);
 
-    //free memory
-    free(newPage);
+    RC rc = RC_ASYNC_IO_UNAVAILABLE;
+    if(backend != SM_AIO_THREADS) {
+        rc = setupRing(engine, queueDepth);
+    }
+    if(rc == RC_OK) {
+        engine->backend = SM_AIO_IO_URING;
+    }
+    else if(backend == SM_AIO_IO_URING) {
+        freeEngine(engine);
+        return rc;
+    }
+    else {
+        // no io_uring here: emulate it with a few threads doing blocking pread/pwrite
+        engine->backend = SM_AIO_THREADS;
+        for(int i = 0; i < SM_AIO_WORKERS; i++) {
+            if(pthread_create(&engine->workers[engine->numWorkers], NULL, asyncWorker, engine) == 0) {
+                engine->numWorkers++;
+            }
+        }
+        // without a worker nothing would ever complete
+        if(engine->numWorkers == 0) {
+            freeEngine(engine);
+            return RC_ASYNC_IO_UNAVAILABLE;
+        }
+    }
 
+    *aio = engine;
     return RC_OK;
 }
 
-RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle) {
-    //if already has enough capacity, return
-    if(fHandle->totalNumPages >= numberOfPages){
+// waits for everything still in flight, then releases the engine
+RC shutdownAsyncIO(SM_AsyncIO *aio) {
+    SM_AsyncRequest *done[16];
+    while(aio->outstanding > 0) {
+        waitAsyncIO(aio, done, 16, 1);
+    }
+
+    if(aio->backend == SM_AIO_IO_URING) {
+        teardownRing(aio);
+    }
+    else {
+        pthread_mutex_lock(&aio->lock);
+        aio->stopping = TRUE;
+        pthread_cond_broadcast(&aio->workCond);
+        pthread_mutex_unlock(&aio->lock);
+        for(int i = 0; i < aio->numWorkers; i++) {
+            pthread_join(aio->workers[i], NULL);
+        }
+    }
+
+    freeEngine(aio);
+    return RC_OK;
+}
+
+SM_AsyncBackend getAsyncBackend(SM_AsyncIO *aio) {
+    return aio->backend;
+}
+
+// adds a request to the current batch; it starts once submitAsyncIO is called
+RC queueAsyncIO(SM_AsyncIO *aio, SM_AsyncRequest *req) {
+    aio->outstanding++;
+
+    RC rc = checkRequest(req);
+    SM_FileMgmt *mgmt = (rc == RC_OK) ? (SM_FileMgmt *)req->fHandle->mgmtInfo : NULL;
+
+    // invalid requests, mapped files and unaligned O_DIRECT buffers gain nothing from going async
+    if(rc != RC_OK || ioModeOf(mgmt) == SM_IO_MMAP || (ioModeOf(mgmt) == SM_IO_DIRECT && !isAligned(req->memPage))) {
+        req->rc = (rc == RC_OK) ? runRequest(req) : rc;
+        pthread_mutex_lock(&aio->lock);
+        pushDone(aio, req);
+        pthread_mutex_unlock(&aio->lock);
         return RC_OK;
     }
 
-    int num = numberOfPages - fHandle->totalNumPages;
-    int i;
-    for (i=0; i < num; i++){
-        appendEmptyBlock(fHandle);
+    if(aio->backend == SM_AIO_IO_URING) {
+        // submission ring full: send what we have
+        if(aio->batchCount == (int)aio->sqEntries) {
+            submitAsyncIO(aio);
+        }
+        // never let more requests be in flight than the completion ring can hold
+        while(aio->inRing + aio->batchCount >= (int)aio->cqEntries) {
+            reapRing(aio, 1);
+        }
+        queueRing(aio, req);
     }
+    else {
+        appendRequest(&aio->batchHead, &aio->batchTail, req);
+    }
+    aio->batchCount++;
     return RC_OK;
 }
+
+// submits every queued request with a single system call (or a single wake-up of the workers)
+RC submitAsyncIO(SM_AsyncIO *aio) {
+    if(aio->backend == SM_AIO_IO_URING) {
+        while(aio->batchCount > 0) {
+            int submitted = ringEnter(aio->ringFd, aio->batchCount, 0, 0);
+            if(submitted < 0) {
+                if(errno == EAGAIN || errno == EBUSY || errno == EINTR) {
+                    reapRing(aio, 1);
+                    continue;
+                }
+                failUnsubmitted(aio);
+                return RC_WRITE_FAILED;
+            }
+            aio->batchCount -= submitted;
+            aio->inRing += submitted;
+        }
+        return RC_OK;
+    }
+
+    if(aio->batchCount > 0) {
+        pthread_mutex_lock(&aio->lock);
+        while(aio->batchHead != NULL) {
+            appendRequest(&aio->workHead, &aio->workTail, popRequest(&aio->batchHead, &aio->batchTail));
+        }
+        aio->batchCount = 0;
+        pthread_cond_broadcast(&aio->workCond);
+        pthread_mutex_unlock(&aio->lock);
+    }
+    return RC_OK;
+}
+
+// returns up to maxCompleted finished requests, blocking until at least minCompleted are available;
+// anything still queued is submitted first so the wait cannot stall on it. Requests the kernel
+// refused come back at once with a failed rc
+int waitAsyncIO(SM_AsyncIO *aio, SM_AsyncRequest **completed, int maxCompleted, int minCompleted) {
+    if(minCompleted > aio->outstanding) {
+        minCompleted = aio->outstanding;
+    }
+    if(minCompleted > maxCompleted) {
+        minCompleted = maxCompleted;
+    }
+
+    submitAsyncIO(aio);
+
+    if(aio->backend == SM_AIO_IO_URING) {
+        reapRing(aio, 0);
+        while(aio->doneCount < minCompleted) {
+            reapRing(aio, minCompleted - aio->doneCount);
+        }
+    }
+
+    pthread_mutex_lock(&aio->lock);
+    while(aio->doneCount < minCompleted) {
+        pthread_cond_wait(&aio->doneCond, &aio->lock);
+    }
+    int n = 0;
+    while(n < maxCompleted && aio->doneHead != NULL) {
+        completed[n++] = popRequest(&aio->doneHead, &aio->doneTail);
+        aio->doneCount--;
+    }
+    aio->outstanding -= n;
+    pthread_mutex_unlock(&aio->lock);
+
+    return n;
+}
+
+// requests queued but not yet returned by waitAsyncIO
+int pendingAsyncIO(SM_AsyncIO *aio) {
+    return aio->outstanding;
+}
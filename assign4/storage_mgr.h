@@ -2,42 +2,107 @@
 #define STORAGE_MGR_H
 
 #include "dberror.h"
+#include "dt.h"
 
 /************************************************************
  *                    handle data structures                *
  ************************************************************/
 typedef struct SM_FileHandle {
 	char *fileName;
-	int totalNumPages;
-	int curPagePos;
+	PageNumber totalNumPages;
+	PageNumber curPagePos;
+	int pageSize;		// bytes per page, chosen when the file was created
 	void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+// page sizes createPageFileWithSize accepts (powers of two); createPageFile uses PAGE_SIZE
+#define SM_MIN_PAGE_SIZE 4096
+#define SM_MAX_PAGE_SIZE 65536
+
+// every page file starts with a header block recording its page size; page 0 follows it
+#define SM_FILE_HEADER_SIZE 4096
+
+// pages of disk space reserved ahead of the file size when a file grows (1 MB)
+#define SM_DEFAULT_GROWTH_CHUNK 256
+
+// how an open page file moves pages between disk and memory
+typedef enum SM_IOMode {
+	SM_IO_PREAD = 0,	// pread/pwrite on the file descriptor
+	SM_IO_MMAP = 1,		// memcpy in and out of a shared mapping of the whole file
+	SM_IO_DIRECT = 2	// pread/pwrite with O_DIRECT, bypassing the kernel page cache
+} SM_IOMode;
+
+// buffer alignment O_DIRECT transfers need; unaligned buffers are bounced through an aligned copy
+#define SM_IO_ALIGNMENT 4096
+
+// which engine executes asynchronous page requests
+typedef enum SM_AsyncBackend {
+	SM_AIO_AUTO = 0,	// io_uring if the kernel allows it, otherwise a thread pool
+	SM_AIO_IO_URING = 1,
+	SM_AIO_THREADS = 2
+} SM_AsyncBackend;
+
+// one outstanding page read or write; owned by the caller until waitAsyncIO hands it back
+typedef struct SM_AsyncRequest {
+	SM_FileHandle *fHandle;
+	PageNumber pageNum;
+	SM_PageHandle memPage;
+	int isWrite;
+	RC rc;				// result, valid once the request has been returned by waitAsyncIO
+	void *userData;			// caller's cookie, untouched by the storage manager
+	struct SM_AsyncRequest *next;	// used internally for queueing
+} SM_AsyncRequest;
+
+typedef struct SM_AsyncIO SM_AsyncIO;
+
+// number of worker threads the thread pool backend starts
+#define SM_AIO_WORKERS 4
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileWithSize (char *fileName, int pageSize);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileMode (char *fileName, SM_FileHandle *fHandle, SM_IOMode mode);
 extern RC closePageFile (SM_FileHandle *fHandle);
+extern SM_IOMode getIOMode (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
 /* reading blocks from disc */
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
-extern int getBlockPos (SM_FileHandle *fHandle);
+extern RC readBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern PageNumber getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocks (PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern RC readBlockList (PageNumber *pageNums, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 
 /* writing blocks to a page file */
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (PageNumber startPage, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+extern RC writeBlockList (PageNumber *pageNums, int count, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
-extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC ensureCapacity (PageNumber numberOfPages, SM_FileHandle *fHandle);
+extern RC setGrowthPolicy (SM_FileHandle *fHandle, int chunkPages, int growthPercent);
+extern RC syncPageFile (SM_FileHandle *fHandle);
+
+/* asynchronous page I/O: queue requests, submit them as one batch, then reap completions.
+ * An engine has a single submitter: calls on one engine must not run concurrently, so threads
+ * sharing an engine serialize them with a lock of their own */
+extern RC initAsyncIO (SM_AsyncIO **aio, int queueDepth, SM_AsyncBackend backend);
+extern RC shutdownAsyncIO (SM_AsyncIO *aio);
+extern SM_AsyncBackend getAsyncBackend (SM_AsyncIO *aio);
+extern RC queueAsyncIO (SM_AsyncIO *aio, SM_AsyncRequest *req);
+extern RC submitAsyncIO (SM_AsyncIO *aio);
+extern int waitAsyncIO (SM_AsyncIO *aio, SM_AsyncRequest **completed, int maxCompleted, int minCompleted);
+extern int pendingAsyncIO (SM_AsyncIO *aio);
 
 #endif
@@ -29,7 +29,7 @@ typedef struct Value {
 } Value;
 
 typedef struct RID {
-	int page;
+	PageNumber page;
 	int slot;
 } RID;
 
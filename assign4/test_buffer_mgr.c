@@ -0,0 +1,1325 @@
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+// var to store the current test's name
+char *testName;
+
+/* test output files */
+#define TESTPF_A "test_buffer_mgr_a.bin"
+#define TESTPF_B "test_buffer_mgr_b.bin"
+
+// check whether the content of a buffer pool is the same as an expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)			        \
+  do {									\
+    char *real;								\
+    char *_exp = (char *) (expected);                                   \
+    real = sprintPoolContent(bm);					\
+    if (strcmp((_exp),real) != 0)					\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+	free(real);							\
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+    free(real);								\
+  } while(0)
+
+// test and helper methods
+static void createDummyPages(char *file, int num);
+static void pinAndUnpin(BM_BufferPool *bm, PageNumber pageNum);
+
+static void testPageMapChurn (void);
+static void testFrameArena (void);
+static void testIndependentPools (void);
+static void testLRUOrder (void);
+static void testLFUOrder (void);
+static void testScanResistance (void);
+static void testClockOrder (void);
+static void testBackgroundWriter (void);
+static void testPrefetch (void);
+static void testScanRing (void);
+static void testShardedPool (void);
+static void testPageLatches (void);
+static void testConcurrentMisses (void);
+static void testSharedCache (void);
+static void testResizePool (void);
+static void testWarmup (void);
+static void testSortedFlush (void);
+static void testPoolStats (void);
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testPageMapChurn();
+  testFrameArena();
+  testIndependentPools();
+  testLRUOrder();
+  testLFUOrder();
+  testScanResistance();
+  testClockOrder();
+  testBackgroundWriter();
+  testPrefetch();
+  testScanRing();
+  testShardedPool();
+  testPageLatches();
+  testConcurrentMisses();
+  testSharedCache();
+  testResizePool();
+  testWarmup();
+  testSortedFlush();
+  testPoolStats();
+
+  return 0;
+}
+
+// many more pages than frames cycle through the pool, so the page map keeps deleting keys
+// out of the middle of probe runs; every pin must still find the right frame or miss
+void
+testPageMapChurn (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  PageNumber *frames;
+  ReplacementStrategy s;
+  char expected[32];
+  int i, page, reads, wrong;
+
+  testName = "Page map under eviction churn";
+
+  createDummyPages(TESTPF_A, 64);
+
+  for (s = RS_FIFO; s <= RS_CLOCK_PRO; s++)
+    {
+      CHECK(initBufferPool(bm, TESTPF_A, 4, s, NULL));
+      wrong = 0;
+      for (i = 0; i < 2000; i++)
+        {
+          page = (i % 3 == 0) ? i % 5 : (i * 37) % 64;
+          CHECK(pinPage(bm, h, page));
+          sprintf(expected, "%s-%i", "Page", page);
+          if (h->pageNum != page || strcmp(expected, h->data) != 0)
+            wrong++;
+          if (i % 7 == 0)
+            CHECK(markDirty(bm, h));
+          CHECK(unpinPage(bm, h));
+        }
+      ASSERT_EQUALS_INT(0, wrong, "every pin got its own page");
+
+      frames = getFrameContents(bm);
+      reads = getNumReadIO(bm);
+      for (i = 0; i < 4; i++)
+        {
+          CHECK(pinPage(bm, h, frames[i]));
+          sprintf(expected, "%s-%i", "Page", (int) frames[i]);
+          ASSERT_EQUALS_STRING(expected, h->data, "resident page content");
+          CHECK(unpinPage(bm, h));
+        }
+      ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "resident pages are found");
+
+      for (page = 0; page < 64; page++)
+        if (page != frames[0] && page != frames[1] && page != frames[2] && page != frames[3])
+          break;
+      free(frames);
+      pinAndUnpin(bm, page);
+      ASSERT_EQUALS_INT(reads + 1, getNumReadIO(bm), "an evicted page misses");
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// every frame buffer is aligned for direct I/O, also in frames a resize adds or keeps, and
+// shutdown releases the pool
+void
+testFrameArena (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolConfig config;
+  char expected[32];
+  int i, c, misaligned, wrong;
+
+  testName = "Aligned frame arena";
+
+  createDummyPages(TESTPF_A, 12);
+
+  for (c = 0; c < 3; c++)
+    {
+      initPoolConfig(&config);
+      config.useAsyncIO = (c == 1);
+      config.numShards = (c == 2) ? 2 : 1;
+      CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 4, RS_LRU, NULL, &config));
+
+      misaligned = 0;
+      wrong = 0;
+      for (i = 0; i < 12; i++)
+        {
+          if (i == 4)
+            CHECK(resizeBufferPool(bm, 10));
+          CHECK(pinPage(bm, h, i));
+          misaligned += ((uintptr_t) h->data % SM_IO_ALIGNMENT) != 0;
+          CHECK(unpinPage(bm, h));
+        }
+      ASSERT_EQUALS_INT(0, misaligned, "frames before and after growing are aligned");
+
+      CHECK(resizeBufferPool(bm, 3));
+      for (i = 0; i < 12; i++)
+        {
+          CHECK(pinPage(bm, h, i));
+          sprintf(expected, "%s-%i", "Page", i);
+          misaligned += ((uintptr_t) h->data % SM_IO_ALIGNMENT) != 0;
+          wrong += strcmp(expected, h->data) != 0;
+          CHECK(unpinPage(bm, h));
+        }
+      ASSERT_EQUALS_INT(0, misaligned, "frames kept by shrinking are aligned");
+      ASSERT_EQUALS_INT(0, wrong, "pages read into the kept frames");
+
+      CHECK(shutdownBufferPool(bm));
+      ASSERT_TRUE(bm->mgmtData == NULL, "shutdown releases the pool");
+    }
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// two pools used in lockstep must not share replacement state or I/O counters
+void
+testIndependentPools (void)
+{
+  BM_BufferPool *a = MAKE_POOL();
+  BM_BufferPool *b = MAKE_POOL();
+  int i;
+
+  testName = "Independent replacement state per pool";
+
+  createDummyPages(TESTPF_A, 10);
+  createDummyPages(TESTPF_B, 10);
+
+  CHECK(initBufferPool(a, TESTPF_A, 3, RS_FIFO, NULL));
+  CHECK(initBufferPool(b, TESTPF_B, 3, RS_FIFO, NULL));
+
+  // interleave the two pools; each one has to evict its own oldest page
+  for (i = 0; i < 4; i++)
+    {
+      pinAndUnpin(a, i);
+      pinAndUnpin(b, 9 - i);
+    }
+  pinAndUnpin(b, 5);
+
+  ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", a, "FIFO order of pool a");
+  ASSERT_EQUALS_POOL("[6 0],[5 0],[7 0]", b, "FIFO order of pool b");
+  ASSERT_EQUALS_INT(4, getNumReadIO(a), "reads counted for pool a only");
+  ASSERT_EQUALS_INT(5, getNumReadIO(b), "reads counted for pool b only");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(a), "no writes for pool a");
+
+  CHECK(shutdownBufferPool(a));
+  CHECK(shutdownBufferPool(b));
+  CHECK(destroyPageFile(TESTPF_A));
+  CHECK(destroyPageFile(TESTPF_B));
+
+  free(a);
+  free(b);
+  TEST_DONE();
+}
+
+// LRU skips pinned frames; LRU-K evicts by the Kth most recent access
+void
+testLRUOrder (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *held = MAKE_PAGE_HANDLE();
+  PageNumber lruSeq[] = { 1, 2, 3, 1, 4, 2, 5 };
+  PageNumber lruKSeq[] = { 1, 2, 3, 1, 2, 1, 4, 3, 5, 2 };
+  int k = 2;
+  int i;
+
+  testName = "LRU and LRU-K victim order";
+
+  createDummyPages(TESTPF_A, 10);
+
+  CHECK(initBufferPool(bm, TESTPF_A, 3, RS_LRU, NULL));
+  for (i = 0; i < 7; i++)
+    pinAndUnpin(bm, lruSeq[i]);
+  ASSERT_EQUALS_POOL("[5 0],[4 0],[2 0]", bm, "least recently used page is replaced");
+  CHECK(pinPage(bm, held, 4));
+  pinAndUnpin(bm, 6);
+  ASSERT_EQUALS_POOL("[5 0],[4 1],[6 0]", bm, "pinned page is skipped");
+  CHECK(unpinPage(bm, held));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, TESTPF_A, 3, RS_LRU_K, &k));
+  for (i = 0; i < 10; i++)
+    pinAndUnpin(bm, lruKSeq[i]);
+  ASSERT_EQUALS_POOL("[1 0],[2 0],[5 0]", bm, "page with the oldest second-to-last access is replaced");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(held);
+  TEST_DONE();
+}
+
+// LFU evicts the least used page, the least recently used one among equals; aging lets a
+// page that was hot long ago go
+void
+testLFUOrder (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PoolConfig config;
+  PageNumber tieSeq[] = { 1, 1, 1, 2, 2, 3, 4, 3, 5, 4 };
+  PageNumber hotSeq[] = { 1, 1, 1, 1, 1, 1, 2, 3, 2, 3, 4, 5, 4, 5 };
+  int i;
+
+  testName = "LFU victim order and aging";
+
+  createDummyPages(TESTPF_A, 10);
+
+  CHECK(initBufferPool(bm, TESTPF_A, 3, RS_LFU, NULL));
+  for (i = 0; i < 10; i++)
+    pinAndUnpin(bm, tieSeq[i]);
+  ASSERT_EQUALS_POOL("[1 0],[2 0],[4 0]", bm, "least frequently used page is replaced, ties by recency");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, TESTPF_A, 3, RS_LFU, NULL));
+  for (i = 0; i < 14; i++)
+    pinAndUnpin(bm, hotSeq[i]);
+  ASSERT_EQUALS_POOL("[1 0],[5 0],[3 0]", bm, "without aging the early hot page stays");
+  CHECK(shutdownBufferPool(bm));
+
+  initPoolConfig(&config);
+  config.lfuAgingInterval = 4;
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 3, RS_LFU, NULL, &config));
+  for (i = 0; i < 14; i++)
+    pinAndUnpin(bm, hotSeq[i]);
+  ASSERT_EQUALS_POOL("[4 0],[5 0],[3 0]", bm, "with aging the early hot page is evicted");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// pages 1 and 2 are used again while resident, then a one-pass scan of 20 pages follows;
+// ARC, 2Q and CLOCK-Pro keep the two pages, LRU loses them
+void
+testScanResistance (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  ReplacementStrategy strategies[] = { RS_ARC, RS_2Q, RS_CLOCK_PRO, RS_LRU };
+  int expectedReads[] = { 0, 0, 0, 2 };
+  PageNumber hotSeq[] = { 1, 2, 3, 4, 5, 6, 1, 2, 1, 2 };
+  int i, s, reads;
+
+  testName = "ARC, 2Q and CLOCK-Pro scan resistance";
+
+  createDummyPages(TESTPF_A, 30);
+
+  for (s = 0; s < 4; s++)
+    {
+      CHECK(initBufferPool(bm, TESTPF_A, 4, strategies[s], NULL));
+      for (i = 0; i < 10; i++)
+        pinAndUnpin(bm, hotSeq[i]);
+      for (i = 10; i < 30; i++)
+        pinAndUnpin(bm, i);
+
+      reads = getNumReadIO(bm);
+      pinAndUnpin(bm, 1);
+      pinAndUnpin(bm, 2);
+      ASSERT_EQUALS_INT(expectedReads[s], getNumReadIO(bm) - reads, "reads to get the hot pages back after the scan");
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// a page used four times survives two sweeps of the GCLOCK hand; with a counter limit of 1
+// (plain CLOCK) it is the first to go
+void
+testClockOrder (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PoolConfig config;
+  PageNumber seq[] = { 1, 1, 1, 1, 2, 3, 4, 5 };
+  int i;
+
+  testName = "GCLOCK usage counters";
+
+  createDummyPages(TESTPF_A, 10);
+
+  CHECK(initBufferPool(bm, TESTPF_A, 3, RS_CLOCK, NULL));
+  for (i = 0; i < 8; i++)
+    pinAndUnpin(bm, seq[i]);
+  ASSERT_EQUALS_POOL("[1 0],[4 0],[5 0]", bm, "frequently used page keeps its frame");
+  CHECK(shutdownBufferPool(bm));
+
+  initPoolConfig(&config);
+  config.clockMaxCount = 1;
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 3, RS_CLOCK, NULL, &config));
+  for (i = 0; i < 8; i++)
+    pinAndUnpin(bm, seq[i]);
+  ASSERT_EQUALS_POOL("[4 0],[5 0],[3 0]", bm, "a reference bit only buys one sweep");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// with the background writer on, dirty pages reach the file without being forced and the
+// next misses find clean victims
+void
+testBackgroundWriter (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolConfig config;
+  PageNumber *frames;
+  bool *dirty;
+  int i, wait;
+
+  testName = "Background dirty-page writer";
+
+  createDummyPages(TESTPF_A, 10);
+
+  initPoolConfig(&config);
+  config.backgroundWriter = TRUE;
+  config.bgDirtyHighPercent = 0;
+  config.bgDirtyLowPercent = 0;
+  config.bgIntervalMs = 5;
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 4, RS_LRU, NULL, &config));
+
+  for (i = 0; i < 4; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Changed", i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+
+  // give the writer up to two seconds
+  for (wait = 0; wait < 400 && getNumWriteIO(bm) < 4; wait++)
+    usleep(5000);
+  ASSERT_EQUALS_INT(4, getNumWriteIO(bm), "dirty pages written in the background");
+  dirty = getDirtyFlags(bm);
+  for (i = 0; i < 4; i++)
+    ASSERT_TRUE(!dirty[i], "frame is clean");
+  free(dirty);
+
+  for (i = 4; i < 8; i++)
+    pinAndUnpin(bm, i);
+  ASSERT_EQUALS_INT(4, getNumWriteIO(bm), "misses found clean victims");
+
+  CHECK(pinPage(bm, h, 2));
+  ASSERT_TRUE(strcmp(h->data, "Changed-2") == 0, "written page read back");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  // the writer takes the pages LRU would evict next: dirtying page 3 starts a round that writes
+  // two pages, 1 and 2, and leaves the recently used 0 and 3 dirty
+  config.bgDirtyHighPercent = 75;
+  config.bgDirtyLowPercent = 50;
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 4, RS_LRU, NULL, &config));
+  for (i = 0; i < 4; i++)
+    {
+      if (i == 3)
+        pinAndUnpin(bm, 0);
+      CHECK(pinPage(bm, h, i));
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+  for (wait = 0; wait < 400 && getNumWriteIO(bm) < 2; wait++)
+    usleep(5000);
+  usleep(20000);
+  ASSERT_EQUALS_INT(2, getNumWriteIO(bm), "writer stopped at the low mark");
+  frames = getFrameContents(bm);
+  dirty = getDirtyFlags(bm);
+  for (i = 0; i < 4; i++)
+    ASSERT_TRUE(dirty[i] == (frames[i] == 0 || frames[i] == 3), "least recently used pages written");
+  free(frames);
+  free(dirty);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// prefetched pages are read once and then pinned without further I/O, both in a synchronous
+// pool and in one that reads its misses asynchronously
+void
+testPrefetch (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolConfig config;
+  char expected[32];
+  int i, async;
+
+  testName = "Prefetching pages";
+
+  createDummyPages(TESTPF_A, 10);
+
+  for (async = 0; async < 2; async++)
+    {
+      initPoolConfig(&config);
+      config.useAsyncIO = async;
+      CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 8, RS_LRU, NULL, &config));
+
+      CHECK(prefetchRange(bm, 2, 4));
+      CHECK(prefetchPage(bm, 3));
+      ASSERT_EQUALS_INT(4, getNumReadIO(bm), "one read per prefetched page");
+      for (i = 2; i < 6; i++)
+        {
+          CHECK(pinPage(bm, h, i));
+          sprintf(expected, "%s-%i", "Page", i);
+          ASSERT_EQUALS_STRING(expected, h->data, "prefetched content");
+          CHECK(unpinPage(bm, h));
+        }
+      ASSERT_EQUALS_INT(4, getNumReadIO(bm), "pins after the prefetch hit");
+
+      CHECK(prefetchRange(bm, 8, 5));
+      ASSERT_EQUALS_INT(6, getNumReadIO(bm), "prefetch stops at the end of the file");
+      ASSERT_ERROR(prefetchPage(bm, 10), "prefetch past the end of the file");
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// a scan through a ring of two frames leaves the other pages of the pool alone, for every
+// strategy; hits on pages already in the pool do not take a ring frame
+void
+testScanRing (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_ScanRing *ring;
+  ReplacementStrategy s;
+  char expected[32];
+  int i, reads;
+
+  testName = "Scan ring";
+
+  createDummyPages(TESTPF_A, 40);
+
+  for (s = RS_FIFO; s <= RS_CLOCK_PRO; s++)
+    {
+      CHECK(initBufferPool(bm, TESTPF_A, 8, s, NULL));
+      for (i = 0; i < 4; i++)
+        pinAndUnpin(bm, i);
+
+      CHECK(initScanRing(bm, &ring, BM_SCAN_RING_SIZE));
+      for (i = 2; i < 40; i++)
+        {
+          CHECK(pinPageWithRing(bm, h, i, ring));
+          sprintf(expected, "%s-%i", "Page", i);
+          ASSERT_EQUALS_STRING(expected, h->data, "scanned content");
+          CHECK(unpinPage(bm, h));
+          if (i % 4 == 0)
+            CHECK(prefetchRangeWithRing(bm, i + 1, 4, ring));
+        }
+      CHECK(freeScanRing(ring));
+      ASSERT_EQUALS_INT(40, getNumReadIO(bm), "every page read once");
+
+      reads = getNumReadIO(bm);
+      for (i = 0; i < 4; i++)
+        pinAndUnpin(bm, i);
+      ASSERT_EQUALS_INT(reads, getNumReadIO(bm), "pages pinned before the scan are still in the pool");
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// worker of testShardedPool: pins pages all over the file and checks their content
+static void *
+shardWorker (void *arg)
+{
+  BM_BufferPool *bm = (BM_BufferPool *) arg;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char expected[32];
+  int i;
+
+  for (i = 0; i < 2000; i++)
+    {
+      PageNumber p = (i * 7 + i / 64) % 64;
+      if (pinPage(bm, h, p) != RC_OK)
+        {
+          printf("[%s] FAILED: pin of page %i\n", testName, (int) p);
+          exit(1);
+        }
+      sprintf(expected, "%s-%i", "Page", (int) p);
+      if (strcmp(expected, h->data) != 0)
+        {
+          printf("[%s] FAILED: page %i holds <%s>\n", testName, (int) p, h->data);
+          exit(1);
+        }
+      unpinPage(bm, h);
+    }
+  free(h);
+  return NULL;
+}
+
+// a sharded pool serves several threads at once and still looks like one pool from outside
+void
+testShardedPool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolConfig config;
+  pthread_t threads[4];
+  PageNumber *pages;
+  int *fixCounts;
+  bool *dirty;
+  int i, j, cached, dirtyCount;
+
+  testName = "Sharded pool";
+
+  createDummyPages(TESTPF_A, 64);
+
+  initPoolConfig(&config);
+  config.numShards = 4;
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 16, RS_LRU, NULL, &config));
+
+  for (i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, shardWorker, bm);
+  for (i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+
+  // the unified view lists every frame exactly once
+  pages = getFrameContents(bm);
+  fixCounts = getFixCounts(bm);
+  cached = 0;
+  for (i = 0; i < 16; i++)
+    {
+      ASSERT_EQUALS_INT(0, fixCounts[i], "no frame left pinned");
+      if (pages[i] != NO_PAGE)
+        cached++;
+      for (j = 0; j < i; j++)
+        if (pages[i] != NO_PAGE && pages[i] == pages[j])
+          {
+            printf("[%s] FAILED: page %i cached twice\n", testName, (int) pages[i]);
+            exit(1);
+          }
+    }
+  ASSERT_TRUE(cached > 0, "frames of all shards listed");
+  free(pages);
+  free(fixCounts);
+
+  // pins, dirty flags and write-back still go to the shard that owns the page
+  CHECK(pinPage(bm, h, 5));
+  sprintf(h->data, "%s", "Changed-5");
+  CHECK(markDirty(bm, h));
+  dirty = getDirtyFlags(bm);
+  dirtyCount = 0;
+  for (i = 0; i < 16; i++)
+    dirtyCount += dirty[i] ? 1 : 0;
+  ASSERT_EQUALS_INT(1, dirtyCount, "one dirty frame in the unified view");
+  free(dirty);
+  ASSERT_EQUALS_INT(RC_SHUTDOWN_WHILE_PINNED_PAGES, shutdownBufferPool(bm), "shutdown refused while a shard has a pin");
+  CHECK(unpinPage(bm, h));
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "dirty page written once");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 16, RS_LRU, NULL, &config));
+  CHECK(pinPage(bm, h, 5));
+  ASSERT_EQUALS_STRING("Changed-5", h->data, "change survived the shutdown");
+  CHECK(unpinPage(bm, h));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// worker of testPageLatches: half the threads update two counters on page 0 under the
+// exclusive latch, the other half check under the shared latch that they always match
+static BM_BufferPool *latchPool;
+
+static void *
+latchWorker (void *arg)
+{
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  bool writer = ((long) arg) % 2 == 0;
+  int i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      int *counters;
+      if (writer)
+        {
+          CHECK(pinPageExclusive(latchPool, h, 0));
+          counters = (int *) h->data;
+          counters[0]++;
+          sched_yield();
+          counters[1] = counters[0];
+          CHECK(markDirty(latchPool, h));
+        }
+      else
+        {
+          CHECK(pinPageShared(latchPool, h, 0));
+          counters = (int *) h->data;
+          if (counters[0] != counters[1])
+            {
+              printf("[%s] FAILED: reader saw a half-done update\n", testName);
+              exit(1);
+            }
+        }
+      CHECK(unpinPage(latchPool, h));
+    }
+  free(h);
+  return NULL;
+}
+
+// unpins page 0 of latchPool after a short delay
+static void *
+delayedUnpin (void *arg)
+{
+  usleep(20000);
+  CHECK(unpinPage(latchPool, (BM_PageHandle *) arg));
+  return NULL;
+}
+
+// content latches keep readers and writers of a page apart, and a pin can wait for a free frame
+void
+testPageLatches (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h1 = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  BM_PoolConfig config;
+  pthread_t threads[4];
+  long i;
+
+  testName = "Page latches and pin waiting";
+
+  createDummyPages(TESTPF_A, 10);
+  latchPool = bm;
+
+  initPoolConfig(&config);
+  config.pinWaitTimeoutMs = 10;
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 2, RS_LRU, NULL, &config));
+  CHECK(pinPageExclusive(bm, h, 0));
+  memset(h->data, 0, 2 * sizeof(int));
+  CHECK(unpinPage(bm, h));
+
+  for (i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, latchWorker, (void *) i);
+  for (i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+  CHECK(pinPageShared(bm, h, 0));
+  ASSERT_EQUALS_INT(2000, ((int *) h->data)[0], "no update lost");
+  CHECK(unpinPage(bm, h));
+
+  // both frames pinned: the pin times out, or succeeds once the other thread unpins
+  CHECK(pinPage(bm, h1, 1));
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_INT(RC_REPLACE_WHILE_PINNED_PAGES, pinPage(bm, h2, 2), "pin fails after the timeout");
+  CHECK(unpinPage(bm, h));
+  CHECK(unpinPage(bm, h1));
+  CHECK(shutdownBufferPool(bm));
+
+  config.pinWaitTimeoutMs = -1;
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 2, RS_LRU, NULL, &config));
+  CHECK(pinPage(bm, h1, 1));
+  CHECK(pinPage(bm, h, 0));
+  pthread_create(&threads[0], NULL, delayedUnpin, h);
+  CHECK(pinPage(bm, h2, 2));
+  pthread_join(threads[0], NULL);
+  ASSERT_EQUALS_STRING("Page-2", h2->data, "pin succeeded once a frame was unpinned");
+  CHECK(unpinPage(bm, h1));
+  CHECK(unpinPage(bm, h2));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(h);
+  free(h1);
+  free(h2);
+  TEST_DONE();
+}
+
+// worker of testConcurrentMisses: thread t bumps a counter on every page p with
+// p % 4 == t, so each pin is a miss that evicts another thread's dirty page
+static BM_BufferPool *missPool;
+
+static void *
+missWorker (void *arg)
+{
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  long t = (long) arg;
+  int round, p;
+
+  for (round = 0; round < 50; round++)
+    for (p = t; p < 40; p += 4)
+      {
+        CHECK(pinPageExclusive(missPool, h, p));
+        if (((int *) h->data)[0] != round)
+          {
+            printf("[%s] FAILED: page %i read %i, expected %i\n", testName, p,
+                   ((int *) h->data)[0], round);
+            exit(1);
+          }
+        ((int *) h->data)[0]++;
+        CHECK(markDirty(missPool, h));
+        CHECK(unpinPage(missPool, h));
+      }
+  free(h);
+  return NULL;
+}
+
+// misses run their I/O unlocked: a page being written back as a victim is never read stale
+void
+testConcurrentMisses (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  pthread_t threads[4];
+  long i;
+  int value;
+
+  testName = "Concurrent misses";
+
+  createDummyPages(TESTPF_A, 40);
+  missPool = bm;
+
+  CHECK(initBufferPool(bm, TESTPF_A, 4, RS_CLOCK, NULL));
+  for (i = 0; i < 40; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      ((int *) h->data)[0] = 0;
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm, h));
+    }
+
+  for (i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, missWorker, (void *) i);
+  for (i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, TESTPF_A, 4, RS_FIFO, NULL));
+  for (i = 0; i < 40; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      value = ((int *) h->data)[0];
+      ASSERT_EQUALS_INT(50, value, "every update reached the disk");
+      CHECK(unpinPage(bm, h));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pools opened in one cache share its frames, keep their pages apart and respect their quotas
+void
+testSharedCache (void)
+{
+  BM_BufferPool *cache = MAKE_POOL();
+  BM_BufferPool *a = MAKE_POOL();
+  BM_BufferPool *b = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  PageNumber *pages;
+  char expected[32];
+  int i, framesA, framesB;
+
+  testName = "Shared buffer cache";
+
+  createDummyPages(TESTPF_A, 10);
+  createDummyPages(TESTPF_B, 10);
+
+  CHECK(initBufferCache(cache, 6, PAGE_SIZE, RS_LRU, NULL, NULL));
+  CHECK(openPoolInCache(a, cache, TESTPF_A, 0));
+  CHECK(openPoolInCache(b, cache, TESTPF_B, 2));
+  ASSERT_EQUALS_INT(RC_FILE_HANDLE_NOT_INIT, pinPage(cache, h, 0), "the cache itself has no pages");
+
+  CHECK(pinPage(b, h, 0));
+  sprintf(h->data, "%s", "B-0");
+  CHECK(markDirty(b, h));
+  CHECK(unpinPage(b, h));
+  for (i = 0; i < 4; i++)
+    {
+      CHECK(pinPage(a, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page of file a");
+      CHECK(unpinPage(a, h));
+      pinAndUnpin(b, i);
+    }
+  CHECK(pinPage(a, h, 0));
+  ASSERT_EQUALS_STRING("Page-0", h->data, "same page number, different file");
+  CHECK(unpinPage(a, h));
+
+  // b is held to 2 frames, a takes the rest
+  pages = getFrameContents(a);
+  framesA = 0;
+  for (i = 0; i < 6; i++)
+    framesA += (pages[i] != NO_PAGE) ? 1 : 0;
+  free(pages);
+  pages = getFrameContents(b);
+  framesB = 0;
+  for (i = 0; i < 6; i++)
+    framesB += (pages[i] != NO_PAGE) ? 1 : 0;
+  free(pages);
+  ASSERT_EQUALS_INT(4, framesA, "file a fills the frames b may not use");
+  ASSERT_EQUALS_INT(2, framesB, "file b stays within its quota");
+  ASSERT_EQUALS_INT(4, getNumReadIO(a), "reads counted per file");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(b), "b's dirty page written when its quota evicted it");
+
+  // a file over its quota replaces its own least recently used page
+  pinAndUnpin(b, 2);
+  pinAndUnpin(b, 4);
+  pages = getFrameContents(b);
+  framesB = 0;
+  for (i = 0; i < 6; i++)
+    framesB += (pages[i] == 2 || pages[i] == 4) ? 1 : 0;
+  free(pages);
+  ASSERT_EQUALS_INT(2, framesB, "b's least recently used page went");
+
+  // keys leave a file 40 bits of page number
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, pinPage(a, h, (PageNumber) 1 << 40), "page number too large for a key");
+
+  // shutting b down leaves a's pages cached; a reopened b reads from its file again
+  CHECK(shutdownBufferPool(b));
+  CHECK(openPoolInCache(b, cache, TESTPF_B, 0));
+  CHECK(pinPage(b, h, 0));
+  ASSERT_EQUALS_STRING("B-0", h->data, "b's change was written back");
+  CHECK(unpinPage(b, h));
+  ASSERT_EQUALS_INT(1, getNumReadIO(b), "reopened file starts with an empty cache share");
+  pinAndUnpin(a, 3);
+  ASSERT_EQUALS_INT(4, getNumReadIO(a), "a's pages are still cached");
+
+  CHECK(shutdownBufferPool(a));
+  CHECK(shutdownBufferPool(b));
+  CHECK(shutdownBufferPool(cache));
+
+  CHECK(destroyPageFile(TESTPF_A));
+  CHECK(destroyPageFile(TESTPF_B));
+
+  free(cache);
+  free(a);
+  free(b);
+  free(h);
+  TEST_DONE();
+}
+
+// a resize keeps resident pages (pinned ones in place) and evicts the strategy's victims, for
+// every strategy and for sharded pools
+void
+testResizePool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_BufferPool *cache = MAKE_POOL();
+  BM_BufferPool *view = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *held = MAKE_PAGE_HANDLE();
+  BM_PoolConfig config;
+  ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q, RS_CLOCK_PRO };
+  PageNumber *pages;
+  char expected[32];
+  char *data;
+  int k = 2;
+  int i, s, shards, resident;
+
+  testName = "Resizing a pool";
+
+  createDummyPages(TESTPF_A, 12);
+
+  CHECK(initBufferPool(bm, TESTPF_A, 4, RS_LRU, NULL));
+  for (i = 0; i < 4; i++)
+    pinAndUnpin(bm, i);
+  CHECK(pinPage(bm, h, 2));
+  CHECK(markDirty(bm, h));
+  CHECK(unpinPage(bm, h));
+  CHECK(pinPageExclusive(bm, held, 0));
+  data = held->data;
+  CHECK(resizeBufferPool(bm, 2));
+  ASSERT_EQUALS_POOL("[0 1],[2x0]", bm, "shrinking evicts the least recently used pages");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "clean victims are not written");
+  ASSERT_TRUE(held->data == data, "a pinned page keeps its buffer");
+  CHECK(pinPage(bm, h, 2));
+  ASSERT_EQUALS_INT(RC_REPLACE_WHILE_PINNED_PAGES, resizeBufferPool(bm, 1), "cannot shrink below the pinned pages");
+  ASSERT_EQUALS_INT(RC_INVALID_POOL_SIZE, resizeBufferPool(bm, 0), "a pool needs a frame");
+  CHECK(unpinPage(bm, h));
+  CHECK(resizeBufferPool(bm, 5));
+  for (i = 5; i < 8; i++)
+    pinAndUnpin(bm, i);
+  ASSERT_EQUALS_POOL("[0 1],[2x0],[5 0],[6 0],[7 0]", bm, "new frames are filled before any page is evicted");
+  CHECK(unpinPage(bm, held));
+  CHECK(pinPageShared(bm, held, 0));
+  CHECK(unpinPage(bm, held));
+  CHECK(resizeBufferPool(bm, 1));
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "a dirty victim is written back");
+  CHECK(shutdownBufferPool(bm));
+
+  // every strategy keeps working across a shrink and a grow; dirty victims reach the file
+  for (shards = 1; shards <= 2; shards++)
+    for (s = 0; s < 8; s++)
+      {
+        initPoolConfig(&config);
+        config.numShards = shards;
+        CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 8, strategies[s], &k, &config));
+        for (i = 0; i < 12; i++)
+          {
+            if (i % 3 == 0)
+              pinAndUnpin(bm, 0);
+            CHECK(pinPage(bm, h, i));
+            if (i % 4 == 1)
+              {
+                sprintf(h->data, "%s-%i", "Resized", i);
+                CHECK(markDirty(bm, h));
+              }
+            CHECK(unpinPage(bm, h));
+          }
+        CHECK(pinPage(bm, held, 11));
+        CHECK(resizeBufferPool(bm, 3));
+        pages = getFrameContents(bm);
+        resident = 0;
+        for (i = 0; i < 3; i++)
+          resident += (pages[i] == 11) ? 1 : 0;
+        free(pages);
+        ASSERT_EQUALS_INT(3, bm->numPages, "pool shrunk");
+        ASSERT_EQUALS_INT(1, resident, "pinned page stays resident");
+        CHECK(resizeBufferPool(bm, 10));
+        for (i = 0; i < 12; i++)
+          {
+            CHECK(pinPage(bm, h, i));
+            if (i % 4 == 1)
+              sprintf(expected, "%s-%i", "Resized", i);
+            else
+              sprintf(expected, "%s-%i", "Page", i);
+            ASSERT_EQUALS_STRING(expected, h->data, "page survives the resizes");
+            CHECK(unpinPage(bm, h));
+          }
+        CHECK(unpinPage(bm, held));
+        CHECK(shutdownBufferPool(bm));
+        CHECK(destroyPageFile(TESTPF_A));
+        createDummyPages(TESTPF_A, 12);
+      }
+
+  // in a shared cache a pool's size is its file's quota
+  CHECK(initBufferCache(cache, 6, PAGE_SIZE, RS_LRU, NULL, NULL));
+  CHECK(openPoolInCache(view, cache, TESTPF_A, 0));
+  CHECK(resizeBufferPool(view, 2));
+  for (i = 0; i < 5; i++)
+    pinAndUnpin(view, i);
+  pages = getFrameContents(view);
+  resident = 0;
+  for (i = 0; i < 6; i++)
+    resident += (pages[i] != NO_PAGE) ? 1 : 0;
+  free(pages);
+  ASSERT_EQUALS_INT(2, resident, "file held to its new quota");
+  CHECK(shutdownBufferPool(view));
+  CHECK(shutdownBufferPool(cache));
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(cache);
+  free(view);
+  free(h);
+  free(held);
+  TEST_DONE();
+}
+
+// a pool started with the manifest its predecessor wrote comes up holding that pool's hottest
+// pages, read in the background, so pinning them needs no further I/O
+void
+testWarmup (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PoolConfig config;
+  BM_PoolStats stats;
+  PageNumber *pages;
+  int shards, round, i, wait, resident;
+
+  testName = "Buffer pool warm-up";
+
+  createDummyPages(TESTPF_A, 10);
+  remove(TESTPF_B);
+
+  initPoolConfig(&config);
+  config.warmupManifest = TESTPF_B;
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 4, RS_LRU, NULL, &config));
+  ASSERT_EQUALS_INT(0, getNumReadIO(bm), "no manifest, nothing to load");
+  for (i = 5; i < 9; i++)
+    pinAndUnpin(bm, i);
+  pinAndUnpin(bm, 6);
+  CHECK(shutdownBufferPool(bm));
+
+  // the smaller pool keeps the three hottest pages
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 3, RS_LRU, NULL, &config));
+  for (wait = 0; wait < 400 && getNumReadIO(bm) < 3; wait++)
+    usleep(5000);
+  ASSERT_EQUALS_POOL("[6 0],[7 0],[8 0]", bm, "hottest pages loaded in page order");
+  for (i = 6; i < 9; i++)
+    pinAndUnpin(bm, i);
+  ASSERT_EQUALS_INT(3, getNumReadIO(bm), "warm pages pinned without I/O");
+  CHECK(shutdownBufferPool(bm));
+
+  // the manifest carries over between strategies and shard counts
+  for (shards = 1; shards <= 2; shards++)
+    {
+      config.numShards = shards;
+      CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 4, RS_CLOCK_PRO, NULL, &config));
+      for (wait = 0; wait < 400 && getNumReadIO(bm) < 3; wait++)
+        usleep(5000);
+      for (i = 6; i < 9; i++)
+        pinAndUnpin(bm, i);
+      ASSERT_EQUALS_INT(3, getNumReadIO(bm), "warm pages pinned without I/O");
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  // the loader only takes empty frames: pages pinned while it runs survive even under CLOCK,
+  // whichever of them gets to the frames first
+  config.numShards = 1;
+  for (round = 0; round < 5; round++)
+    {
+      remove(TESTPF_B);
+      CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 4, RS_FIFO, NULL, &config));
+      for (i = 0; i < 4; i++)
+        pinAndUnpin(bm, 4 + i);
+      CHECK(shutdownBufferPool(bm));
+
+      CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 8, RS_CLOCK, NULL, &config));
+      for (i = 0; i < 4; i++)
+        pinAndUnpin(bm, i);
+      for (wait = 0; wait < 400 && getNumReadIO(bm) < 8; wait++)
+        usleep(5000);
+      CHECK(getPoolStats(bm, &stats));
+      ASSERT_EQUALS_INT(0, (int) stats.evictions, "nothing evicted for a warm page");
+      pages = getFrameContents(bm);
+      resident = 0;
+      for (i = 0; i < 8; i++)
+        resident += (pages[i] >= 0 && pages[i] < 4) ? 1 : 0;
+      free(pages);
+      ASSERT_EQUALS_INT(4, resident, "pages pinned during warm-up stay resident");
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile(TESTPF_A));
+  remove(TESTPF_B);
+
+  free(bm);
+  TEST_DONE();
+}
+
+// forceFlushPool writes every dirty, unpinned page once, whatever order the frames hold them
+// in, leaves pinned pages dirty, and with syncOnFlush also makes the writes durable
+void
+testSortedFlush (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *held = MAKE_PAGE_HANDLE();
+  BM_PoolConfig config;
+  PageNumber order[] = { 9, 3, 4, 0, 8, 5, 1, 7 };
+  char expected[32];
+  bool *dirty;
+  int shards, i, numDirty;
+
+  testName = "Sorted, coalesced flushing";
+
+  createDummyPages(TESTPF_A, 10);
+
+  for (shards = 1; shards <= 2; shards++)
+    {
+      initPoolConfig(&config);
+      config.numShards = shards;
+      config.syncOnFlush = TRUE;
+      CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 8, RS_LRU, NULL, &config));
+      for (i = 0; i < 8; i++)
+        {
+          CHECK(pinPage(bm, h, order[i]));
+          sprintf(h->data, "%s-%i-%i", "Flushed", shards, (int) order[i]);
+          CHECK(markDirty(bm, h));
+          CHECK(unpinPage(bm, h));
+        }
+      CHECK(pinPage(bm, held, 4));
+      CHECK(forceFlushPool(bm));
+      ASSERT_EQUALS_INT(7, getNumWriteIO(bm), "each unpinned dirty page written once");
+      dirty = getDirtyFlags(bm);
+      numDirty = 0;
+      for (i = 0; i < 8; i++)
+        numDirty += dirty[i] ? 1 : 0;
+      free(dirty);
+      ASSERT_EQUALS_INT(1, numDirty, "only the pinned page stays dirty");
+      CHECK(unpinPage(bm, held));
+      CHECK(shutdownBufferPool(bm));
+
+      CHECK(initBufferPool(bm, TESTPF_A, 3, RS_FIFO, NULL));
+      for (i = 0; i < 10; i++)
+        {
+          CHECK(pinPage(bm, h, i));
+          if (i == 2 || i == 6)
+            sprintf(expected, "%s-%i", "Page", i);
+          else
+            sprintf(expected, "%s-%i-%i", "Flushed", shards, i);
+          ASSERT_EQUALS_STRING(expected, h->data, "flushed page read back");
+          CHECK(unpinPage(bm, h));
+        }
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile(TESTPF_A));
+
+  free(bm);
+  free(h);
+  free(held);
+  TEST_DONE();
+}
+
+// getPoolStats counts hits, misses, clean and dirty evictions and pins that found every frame
+// pinned; the exports carry the same numbers
+void
+testPoolStats (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h[4];
+  BM_PoolConfig config;
+  BM_PoolStats stats;
+  char *text;
+  RC rc;
+  int i;
+
+  testName = "Pool statistics";
+
+  createDummyPages(TESTPF_A, 10);
+  for (i = 0; i < 4; i++)
+    h[i] = MAKE_PAGE_HANDLE();
+
+  initPoolConfig(&config);
+  config.pinWaitTimeoutMs = 1;
+  CHECK(initBufferPoolWithConfig(bm, TESTPF_A, 3, RS_LRU, NULL, &config));
+  for (i = 0; i < 3; i++)
+    pinAndUnpin(bm, i);
+  pinAndUnpin(bm, 0);
+  CHECK(pinPage(bm, h[0], 1));
+  CHECK(markDirty(bm, h[0]));
+  CHECK(unpinPage(bm, h[0]));
+  pinAndUnpin(bm, 0);
+  pinAndUnpin(bm, 3);
+  pinAndUnpin(bm, 4);
+  for (i = 0; i < 3; i++)
+    CHECK(pinPage(bm, h[i], 5 + i));
+  rc = pinPage(bm, h[3], 9);
+  ASSERT_EQUALS_INT(RC_REPLACE_WHILE_PINNED_PAGES, rc, "every frame pinned");
+  CHECK(markDirty(bm, h[0]));
+
+  CHECK(getPoolStats(bm, &stats));
+  ASSERT_EQUALS_INT(3, (int) stats.hits, "hits");
+  ASSERT_EQUALS_INT(8, (int) stats.misses, "misses");
+  ASSERT_TRUE(stats.hitRatio > 0.27 && stats.hitRatio < 0.28, "hit ratio");
+  ASSERT_EQUALS_INT(5, (int) stats.evictions, "evictions");
+  ASSERT_EQUALS_INT(1, (int) stats.dirtyEvictions, "dirty victim");
+  ASSERT_EQUALS_INT(1, (int) stats.pinWaits, "pin waited for a frame");
+  ASSERT_EQUALS_INT(1, (int) stats.failedPins, "pin failed");
+  ASSERT_EQUALS_INT(1, stats.dirtyPages, "dirty pages");
+  ASSERT_EQUALS_INT(8, (int) stats.victimSearches, "a victim search per miss");
+  ASSERT_TRUE(stats.victimSearchSteps >= stats.victimSearches, "search steps counted");
+  ASSERT_EQUALS_INT(8, (int) stats.readLatency.count, "every read timed");
+  ASSERT_EQUALS_INT(1, (int) stats.writeLatency.count, "every write timed");
+
+  text = sprintPoolStatsJSON(bm);
+  ASSERT_TRUE(strstr(text, "\"hits\":3,\"misses\":8,") != NULL, "JSON counters");
+  free(text);
+  text = sprintPoolStatsPrometheus(bm);
+  ASSERT_TRUE(strstr(text, "bm_hits_total{pool=\"" TESTPF_A "\",strategy=\"LRU\"} 3\n") != NULL, "Prometheus counter");
+  ASSERT_TRUE(strstr(text, "bm_read_latency_microseconds_bucket{pool=\"" TESTPF_A "\",strategy=\"LRU\",le=\"+Inf\"} 8\n") != NULL,
+      "Prometheus histogram");
+  free(text);
+  text = sprintPoolPageContent(bm, h[0]);
+  ASSERT_TRUE(strncmp(text, "[Page 5]\n50616765", 17) == 0, "page dump starts at the first byte");
+  ASSERT_EQUALS_INT(9 + 2 * PAGE_SIZE + PAGE_SIZE / 8 + PAGE_SIZE / 64, (int) strlen(text), "page dump covers the page");
+  free(text);
+
+  for (i = 0; i < 3; i++)
+    CHECK(unpinPage(bm, h[i]));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(TESTPF_A));
+
+  for (i = 0; i < 4; i++)
+    free(h[i]);
+  free(bm);
+  TEST_DONE();
+}
+
+void
+pinAndUnpin(BM_BufferPool *bm, PageNumber pageNum)
+{
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  CHECK(pinPage(bm, h, pageNum));
+  CHECK(unpinPage(bm, h));
+  free(h);
+}
+
+// create n pages with content "Page X"
+void
+createDummyPages(char *file, int num)
+{
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  CHECK(createPageFile(file));
+  CHECK(initBufferPool(bm, file, 3, RS_FIFO, NULL));
+
+  for (i = 0; i < num; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", i);
+      CHECK(markDirty(bm, h));
+      CHECK(unpinPage(bm,h));
+    }
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(bm);
+  free(h);
+}
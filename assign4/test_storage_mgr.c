@@ -0,0 +1,459 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "storage_mgr.h"
+#include "dberror.h"
+#include "dt.h"
+#include "test_helper.h"
+
+// test name
+char *testName;
+
+/* test output files */
+#define TESTPF "test_storage_mgr.bin"
+
+/* prototypes for test functions */
+static void testPersistentHandle(void);
+static void testMappedPageContent(void);
+static void testVectoredIO(void);
+static void testFileGrowth(void);
+static void testLargeFile(void);
+static void testPageSizes(void);
+static void testDirectIO(void);
+static void testAsyncIO(SM_AsyncBackend backend);
+
+/* main function running all tests */
+int
+main (void)
+{
+  testName = "";
+
+  initStorageManager();
+
+  testPersistentHandle();
+  testMappedPageContent();
+  testVectoredIO();
+  testFileGrowth();
+  testLargeFile();
+  testPageSizes();
+  testDirectIO();
+  testAsyncIO(SM_AIO_AUTO);
+  testAsyncIO(SM_AIO_THREADS);
+
+  return 0;
+}
+
+/* one handle stays open while the file grows and is written and read in any order; a new
+   handle then sees everything that went through it */
+void
+testPersistentHandle(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i;
+
+  testName = "test persistent file handle";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+
+  for (i=0; i < 20; i++)
+    {
+      if (i > 0)
+        TEST_CHECK(appendEmptyBlock (&fh));
+      memset(ph, 'a' + i, PAGE_SIZE);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+      TEST_CHECK(readBlock (i / 2, &fh, ph));
+      ASSERT_TRUE((ph[0] == 'a' + i / 2 && ph[PAGE_SIZE - 1] == 'a' + i / 2), "earlier page reads back while the file grows");
+    }
+
+  TEST_CHECK(ensureCapacity (40, &fh));
+  for (i=39; i >= 20; i--)
+    {
+      memset(ph, 'A' + i - 20, PAGE_SIZE);
+      TEST_CHECK(writeBlock (i, &fh, ph));
+    }
+  TEST_CHECK(readFirstBlock (&fh, ph));
+  ASSERT_TRUE((ph[0] == 'a'), "first page after writing backwards from the end");
+  TEST_CHECK(readNextBlock (&fh, ph));
+  ASSERT_TRUE((ph[0] == 'b'), "next page follows the current position");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_TRUE((fh.totalNumPages == 40), "reopened file has every appended page");
+  for (i=0; i < 40; i++)
+    {
+      TEST_CHECK(readBlock (i, &fh, ph));
+      ASSERT_TRUE((ph[0] == ph[PAGE_SIZE - 1] && ph[0] == (i < 20 ? 'a' + i : 'A' + i - 20)), "reopened page has what was written");
+    }
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* write pages through a mapped handle, grow it, and read them back through a regular one */
+void
+testMappedPageContent(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i;
+
+  testName = "test mmap page content";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFileMode (TESTPF, &fh, SM_IO_MMAP));
+  ASSERT_TRUE((fh.totalNumPages == 1), "expect 1 page in new file");
+
+  TEST_CHECK(readFirstBlock (&fh, ph));
+  for (i=0; i < PAGE_SIZE; i++)
+    ASSERT_TRUE((ph[i] == 0), "expected zero byte in first page of freshly initialized page");
+
+  // grow the mapping and fill the last page
+  TEST_CHECK(ensureCapacity (5, &fh));
+  ASSERT_TRUE((fh.totalNumPages == 5), "expect 5 pages after ensureCapacity");
+  TEST_CHECK(appendEmptyBlock (&fh));
+  ASSERT_TRUE((fh.totalNumPages == 6), "expect 6 pages after appendEmptyBlock");
+
+  for (i=0; i < PAGE_SIZE; i++)
+    ph[i] = (i % 10) + '0';
+  TEST_CHECK(writeBlock (5, &fh, ph));
+  TEST_CHECK(syncPageFile (&fh));
+  ASSERT_TRUE((readBlock (6, &fh, ph) != RC_OK), "reading past the end of the mapping should fail");
+  TEST_CHECK(closePageFile (&fh));
+
+  // the pages must be visible to a descriptor-based handle after closing the mapping
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_TRUE((fh.totalNumPages == 6), "expect 6 pages after reopening");
+  memset(ph, 0, PAGE_SIZE);
+  TEST_CHECK(readLastBlock (&fh, ph));
+  for (i=0; i < PAGE_SIZE; i++)
+    ASSERT_TRUE((ph[i] == (i % 10) + '0'), "character in page read from disk is the one we expected.");
+  TEST_CHECK(readBlock (3, &fh, ph));
+  for (i=0; i < PAGE_SIZE; i++)
+    ASSERT_TRUE((ph[i] == 0), "expected zero byte in a page added by ensureCapacity");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* write a range of pages with one call and read them back, both as a range and as a page list */
+void
+testVectoredIO(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph[8];
+  PageNumber pageNums[] = { 6, 2, 3, 4, 0 };
+  int i, j;
+
+  testName = "test vectored page I/O";
+
+  for (i=0; i < 8; i++)
+    ph[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (8, &fh));
+
+  for (i=0; i < 8; i++)
+    memset(ph[i], 'a' + i, PAGE_SIZE);
+  TEST_CHECK(writeBlocks (0, 8, &fh, ph));
+  ASSERT_TRUE((getBlockPos(&fh) == 7), "current position is the last page written");
+  ASSERT_TRUE((writeBlocks (4, 8, &fh, ph) != RC_OK), "writing past the end of the file should fail");
+
+  for (i=0; i < 8; i++)
+    memset(ph[i], 0, PAGE_SIZE);
+  TEST_CHECK(readBlocks (2, 4, &fh, ph));
+  for (i=0; i < 4; i++)
+    for (j=0; j < PAGE_SIZE; j++)
+      ASSERT_TRUE((ph[i][j] == 'a' + 2 + i), "page read by readBlocks has the expected content");
+
+  // overwrite a scattered set of pages, then read them back in the same order
+  for (i=0; i < 5; i++)
+    memset(ph[i], 'A' + pageNums[i], PAGE_SIZE);
+  TEST_CHECK(writeBlockList (pageNums, 5, &fh, ph));
+  TEST_CHECK(syncPageFile (&fh));
+  for (i=0; i < 5; i++)
+    memset(ph[i], 0, PAGE_SIZE);
+  TEST_CHECK(readBlockList (pageNums, 5, &fh, ph));
+  for (i=0; i < 5; i++)
+    for (j=0; j < PAGE_SIZE; j++)
+      ASSERT_TRUE((ph[i][j] == 'A' + pageNums[i]), "page read by readBlockList has the expected content");
+
+  // pages not in the list keep their old content
+  TEST_CHECK(readBlock (5, &fh, ph[0]));
+  ASSERT_TRUE((ph[0][0] == 'a' + 5), "page outside the list is untouched");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  for (i=0; i < 8; i++)
+    free(ph[i]);
+
+  TEST_DONE();
+}
+
+/* grow a file in bulk and make sure the space reserved ahead does not show up as pages */
+void
+testFileGrowth(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i;
+
+  testName = "test bulk file growth";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(setGrowthPolicy (&fh, 16, 10));
+
+  for (i=0; i < 20; i++)
+    TEST_CHECK(appendEmptyBlock (&fh));
+  ASSERT_TRUE((fh.totalNumPages == 21), "expect 21 pages after 20 appends");
+
+  TEST_CHECK(ensureCapacity (1000, &fh));
+  ASSERT_TRUE((fh.totalNumPages == 1000), "expect 1000 pages after ensureCapacity");
+  TEST_CHECK(ensureCapacity (10, &fh));
+  ASSERT_TRUE((fh.totalNumPages == 1000), "ensureCapacity never shrinks the file");
+
+  memset(ph, 'z', PAGE_SIZE);
+  TEST_CHECK(writeBlock (999, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_TRUE((fh.totalNumPages == 1000), "reopened file has exactly the pages that were asked for");
+  TEST_CHECK(readBlock (500, &fh, ph));
+  for (i=0; i < PAGE_SIZE; i++)
+    ASSERT_TRUE((ph[i] == 0), "expected zero byte in a page added by ensureCapacity");
+  TEST_CHECK(readLastBlock (&fh, ph));
+  ASSERT_TRUE((ph[0] == 'z'), "last page keeps what was written to it");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* pages past the 2 GB mark are addressed with 64-bit offsets; the file is sparse so no disk is used */
+void
+testLargeFile(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  PageNumber lastPage = ((PageNumber) 3 << 30) / PAGE_SIZE;
+
+  testName = "test 64-bit page offsets";
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  ASSERT_TRUE((truncate(TESTPF, SM_FILE_HEADER_SIZE + (off_t) (lastPage + 1) * PAGE_SIZE) == 0), "extend file to 3 GB");
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_TRUE((fh.totalNumPages == lastPage + 1), "page count past 2^31 bytes");
+
+  memset(ph, 'q', PAGE_SIZE);
+  TEST_CHECK(writeBlock (lastPage, &fh, ph));
+  memset(ph, 0, PAGE_SIZE);
+  TEST_CHECK(readLastBlock (&fh, ph));
+  ASSERT_TRUE((ph[0] == 'q' && ph[PAGE_SIZE - 1] == 'q'), "last page of a 3 GB file reads back");
+  ASSERT_TRUE((getBlockPos (&fh) == lastPage), "block position is not truncated");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* page files remember the page size they were created with, in every I/O mode */
+void
+testPageSizes(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  SM_IOMode modes[] = { SM_IO_PREAD, SM_IO_MMAP, SM_IO_DIRECT };
+  int pageSize = 16384;
+  int i, m;
+  FILE *legacy;
+
+  testName = "test page sizes";
+
+  ASSERT_TRUE((createPageFileWithSize (TESTPF, 2048) == RC_INVALID_PAGE_SIZE), "page smaller than 4 KB is rejected");
+  ASSERT_TRUE((createPageFileWithSize (TESTPF, 131072) == RC_INVALID_PAGE_SIZE), "page larger than 64 KB is rejected");
+  ASSERT_TRUE((createPageFileWithSize (TESTPF, 12288) == RC_INVALID_PAGE_SIZE), "page size must be a power of two");
+
+  posix_memalign((void **) &ph, SM_IO_ALIGNMENT, pageSize);
+
+  TEST_CHECK(createPageFileWithSize (TESTPF, pageSize));
+  for (m=0; m < 3; m++)
+  {
+    TEST_CHECK(openPageFileMode (TESTPF, &fh, modes[m]));
+    ASSERT_TRUE((fh.pageSize == pageSize), "page size is read back from the file header");
+    TEST_CHECK(ensureCapacity (3 + m, &fh));
+
+    for (i=0; i < pageSize; i++)
+      ph[i] = (i + m) % 251;
+    TEST_CHECK(writeBlock (2 + m, &fh, ph));
+    TEST_CHECK(closePageFile (&fh));
+  }
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_TRUE((fh.totalNumPages == 5), "page count is in units of the file's page size");
+  for (m=0; m < 3; m++)
+  {
+    TEST_CHECK(readBlock (2 + m, &fh, ph));
+    for (i=0; i < pageSize; i++)
+      ASSERT_TRUE((ph[i] == (char) ((i + m) % 251)), "large page reads back whole");
+  }
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  // a file written before page sizes were recorded has no header and PAGE_SIZE pages
+  legacy = fopen(TESTPF, "w");
+  memset(ph, 'l', PAGE_SIZE);
+  fwrite(ph, 1, PAGE_SIZE, legacy);
+  fwrite(ph, 1, PAGE_SIZE, legacy);
+  fclose(legacy);
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_TRUE((fh.pageSize == PAGE_SIZE && fh.totalNumPages == 2), "headerless file has two default-sized pages");
+  TEST_CHECK(readFirstBlock (&fh, ph));
+  ASSERT_TRUE((ph[0] == 'l'), "headerless file is read from offset 0");
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* O_DIRECT handles accept both aligned and unaligned page buffers, or fall back to buffered I/O */
+void
+testDirectIO(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle aligned;
+  SM_PageHandle unaligned;
+  SM_PageHandle pages[2];
+  int i;
+
+  testName = "test direct I/O mode";
+
+  TEST_CHECK(posix_memalign((void **)&aligned, SM_IO_ALIGNMENT, PAGE_SIZE) == 0 ? RC_OK : RC_WRITE_FAILED);
+  unaligned = (SM_PageHandle) malloc(PAGE_SIZE + 1) + 1;
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFileMode (TESTPF, &fh, SM_IO_DIRECT));
+  ASSERT_TRUE((getIOMode(&fh) == SM_IO_DIRECT || getIOMode(&fh) == SM_IO_PREAD), "direct mode or buffered fallback");
+  TEST_CHECK(ensureCapacity (3, &fh));
+
+  memset(aligned, 'd', PAGE_SIZE);
+  TEST_CHECK(writeBlock (1, &fh, aligned));
+  memset(unaligned, 'u', PAGE_SIZE);
+  TEST_CHECK(writeBlock (2, &fh, unaligned));
+
+  memset(unaligned, 0, PAGE_SIZE);
+  TEST_CHECK(readBlock (1, &fh, unaligned));
+  for (i=0; i < PAGE_SIZE; i++)
+    ASSERT_TRUE((unaligned[i] == 'd'), "unaligned buffer reads back the aligned write");
+
+  pages[0] = aligned;
+  pages[1] = unaligned;
+  TEST_CHECK(readBlocks (1, 2, &fh, pages));
+  ASSERT_TRUE((aligned[0] == 'd' && unaligned[PAGE_SIZE - 1] == 'u'), "vectored read mixes aligned and unaligned buffers");
+  TEST_CHECK(closePageFile (&fh));
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(aligned);
+  free(unaligned - 1);
+
+  TEST_DONE();
+}
+
+/* write and read back a batch of pages through the asynchronous engine */
+void
+testAsyncIO(SM_AsyncBackend backend)
+{
+  SM_FileHandle fh;
+  SM_AsyncIO *aio;
+  SM_AsyncRequest reqs[40];
+  SM_AsyncRequest *done[40];
+  SM_PageHandle ph[40];
+  int i, n, seen;
+
+  testName = (backend == SM_AIO_THREADS) ? "test async I/O (thread pool)" : "test async I/O";
+
+  for (i=0; i < 40; i++)
+    TEST_CHECK(posix_memalign((void **)&ph[i], SM_IO_ALIGNMENT, PAGE_SIZE) == 0 ? RC_OK : RC_WRITE_FAILED);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (40, &fh));
+  // a small queue forces requests to be submitted and reaped in several rounds
+  TEST_CHECK(initAsyncIO (&aio, 8, backend));
+  if (backend == SM_AIO_THREADS)
+    ASSERT_TRUE((getAsyncBackend(aio) == SM_AIO_THREADS), "thread pool backend was selected");
+
+  for (i=0; i < 40; i++)
+  {
+    memset(ph[i], 'A' + (i % 26), PAGE_SIZE);
+    reqs[i].fHandle = &fh;
+    reqs[i].pageNum = i;
+    reqs[i].memPage = ph[i];
+    reqs[i].isWrite = TRUE;
+    reqs[i].userData = NULL;
+    TEST_CHECK(queueAsyncIO (aio, &reqs[i]));
+  }
+  TEST_CHECK(submitAsyncIO (aio));
+  for (seen=0; seen < 40; seen += n)
+  {
+    n = waitAsyncIO(aio, done, 40, 1);
+    for (i=0; i < n; i++)
+      TEST_CHECK(done[i]->rc);
+  }
+  ASSERT_TRUE((pendingAsyncIO(aio) == 0), "all writes were reaped");
+
+  for (i=0; i < 40; i++)
+  {
+    memset(ph[i], 0, PAGE_SIZE);
+    reqs[i].isWrite = FALSE;
+    reqs[i].userData = &reqs[i];
+    TEST_CHECK(queueAsyncIO (aio, &reqs[i]));
+  }
+  n = waitAsyncIO(aio, done, 40, 40);
+  ASSERT_TRUE((n == 40), "waiting for 40 reads returns 40 completions");
+  for (i=0; i < n; i++)
+  {
+    ASSERT_TRUE((done[i]->userData == done[i]), "user data survives the round trip");
+    TEST_CHECK(done[i]->rc);
+    ASSERT_TRUE((done[i]->memPage[0] == 'A' + (done[i]->pageNum % 26)), "async read returns the page written asynchronously");
+  }
+
+  // an out of range page completes with an error instead of being submitted
+  reqs[0].pageNum = 40;
+  TEST_CHECK(queueAsyncIO (aio, &reqs[0]));
+  ASSERT_TRUE((waitAsyncIO(aio, done, 1, 1) == 1 && done[0]->rc != RC_OK), "reading past the end fails");
+
+  TEST_CHECK(shutdownAsyncIO (aio));
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  for (i=0; i < 40; i++)
+    free(ph[i]);
+
+  TEST_DONE();
+}